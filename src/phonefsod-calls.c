@@ -0,0 +1,246 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "phonefsod-calls.h"
+#include "phonefsod-histogram.h"
+#include "phonefsod-contacts.h"
+#include "phonefsod-recorder.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_CALLS
+#include "phonefsod-log.h"
+
+static const char *direction_names[] = {
+	[CALL_DIRECTION_INCOMING] = "incoming",
+	[CALL_DIRECTION_OUTGOING] = "outgoing",
+};
+
+static const char *state_names[CALL_STATE_COUNT] = {
+	[CALL_STATE_INCOMING] = "incoming",
+	[CALL_STATE_OUTGOING] = "outgoing",
+	[CALL_STATE_ACTIVE] = "active",
+	[CALL_STATE_HELD] = "held",
+	[CALL_STATE_RELEASE] = "release",
+};
+
+/* slots are found by the call id with linear probing, as call ids are
+ * small numbers this is a direct hit unless stale ids linger around */
+static call_t calls[CALL_TABLE_SIZE];
+static int calls_by_direction[2];
+
+/* signal arrival of an incoming call until phoneui showed it */
+static histogram_t display_latency = HISTOGRAM_INIT("display-latency");
+/* incoming call ringing until answered or released */
+static histogram_t ring_duration = HISTOGRAM_INIT("ring-duration");
+/* outgoing call dialing until the peer answered */
+static histogram_t answer_latency = HISTOGRAM_INIT("answer-latency");
+
+static void _copy_peer(char *dest, const char *peer);
+
+call_t *
+calls_lookup(int id)
+{
+	int i, slot;
+
+	for (i = 0; i < CALL_TABLE_SIZE; i++) {
+		slot = (id + i) & (CALL_TABLE_SIZE - 1);
+		if (calls[slot].used && calls[slot].id == id)
+			return &calls[slot];
+	}
+	return NULL;
+}
+
+call_t *
+calls_add(int id, enum CallDirection direction, const char *peer)
+{
+	int i, slot;
+	call_t *call;
+	const char *name;
+
+	log_debug("calls_add(%d)", id);
+	for (i = 0; i < CALL_TABLE_SIZE; i++) {
+		slot = (id + i) & (CALL_TABLE_SIZE - 1);
+		if (!calls[slot].used)
+			break;
+	}
+	if (i == CALL_TABLE_SIZE) {
+		g_warning("call table is full - not tracking call %d", id);
+		return NULL;
+	}
+
+	call = &calls[slot];
+	memset(call, 0, sizeof(call_t));
+	call->used = TRUE;
+	call->id = id;
+	call->direction = direction;
+	_copy_peer(call->peer, peer);
+	name = contacts_lookup(call->peer);
+	if (name)
+		g_strlcpy(call->name, name, CALL_NAME_MAX);
+	calls_by_direction[direction]++;
+	call->state = direction == CALL_DIRECTION_INCOMING ?
+			CALL_STATE_INCOMING : CALL_STATE_OUTGOING;
+	call->since[call->state] = g_get_monotonic_time();
+
+	return call;
+}
+
+static gboolean
+_transition_valid(enum CallState from, enum CallState to)
+{
+	if (to == CALL_STATE_RELEASE)
+		return TRUE;
+
+	switch (from) {
+	case CALL_STATE_INCOMING:
+	case CALL_STATE_OUTGOING:
+		return to == CALL_STATE_ACTIVE;
+	case CALL_STATE_ACTIVE:
+		return to == CALL_STATE_HELD;
+	case CALL_STATE_HELD:
+		return to == CALL_STATE_ACTIVE;
+	default:
+		return FALSE;
+	}
+}
+
+gboolean
+calls_set_state(call_t *call, enum CallState state)
+{
+	gint64 now;
+
+	if (call->state == state)
+		return TRUE;
+	if (!_transition_valid(call->state, state)) {
+		g_warning("ignoring invalid transition of call %d from %s to %s",
+			  call->id, state_names[call->state], state_names[state]);
+		return FALSE;
+	}
+
+	now = g_get_monotonic_time();
+	recorder_add(REC_CALL_STATE, call->id, state);
+	if (call->state == CALL_STATE_INCOMING) {
+		histogram_add(&ring_duration, now - call->since[CALL_STATE_INCOMING]);
+	}
+	else if (call->state == CALL_STATE_OUTGOING &&
+			state == CALL_STATE_ACTIVE) {
+		histogram_add(&answer_latency, now - call->since[CALL_STATE_OUTGOING]);
+	}
+	log_debug("call %d: %s -> %s", call->id, state_names[call->state],
+		state_names[state]);
+
+	call->state = state;
+	call->since[state] = now;
+	return TRUE;
+}
+
+/* phoneui completed showing the incoming call */
+void
+calls_incoming_displayed(int id)
+{
+	call_t *call = calls_lookup(id);
+	gint64 latency;
+
+	if (!call || call->displayed || call->direction != CALL_DIRECTION_INCOMING)
+		return;
+
+	call->displayed = TRUE;
+	latency = g_get_monotonic_time() - call->since[CALL_STATE_INCOMING];
+	histogram_add(&display_latency, latency);
+	log_debug("incoming call %d displayed after %" G_GINT64_FORMAT "ms",
+		id, latency / 1000);
+}
+
+void
+calls_remove(call_t *call)
+{
+	log_debug("calls_remove(%d)", call->id);
+	calls_by_direction[call->direction]--;
+	call->used = FALSE;
+}
+
+int
+calls_count(enum CallDirection direction)
+{
+	return calls_by_direction[direction];
+}
+
+int
+calls_total()
+{
+	return calls_by_direction[CALL_DIRECTION_INCOMING] +
+		calls_by_direction[CALL_DIRECTION_OUTGOING];
+}
+
+/* a(issssxx) of id, direction, state, peer number, contact name and
+ * the monotonic us when the call was created and when it entered its state */
+GVariant *
+calls_to_variant()
+{
+	GVariantBuilder builder;
+	int i;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(issssxx)"));
+	for (i = 0; i < CALL_TABLE_SIZE; i++) {
+		call_t *call = &calls[i];
+		if (!call->used)
+			continue;
+		g_variant_builder_add(&builder, "(issssxx)", call->id,
+			direction_names[call->direction],
+			state_names[call->state], call->peer, call->name,
+			call->since[call->direction == CALL_DIRECTION_INCOMING ?
+				CALL_STATE_INCOMING : CALL_STATE_OUTGOING],
+			call->since[call->state]);
+	}
+
+	return g_variant_builder_end(&builder);
+}
+
+/* a(suxxxau) of the display latency, ring duration
+ * and answer latency histograms */
+GVariant *
+calls_metrics_to_variant()
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(suxxxau)"));
+	g_variant_builder_add_value(&builder, histogram_to_variant(&display_latency));
+	g_variant_builder_add_value(&builder, histogram_to_variant(&ring_duration));
+	g_variant_builder_add_value(&builder, histogram_to_variant(&answer_latency));
+
+	return g_variant_builder_end(&builder);
+}
+
+/* copies the peer number stripping the quotes some modems add */
+static void
+_copy_peer(char *dest, const char *peer)
+{
+	gsize len;
+
+	if (!peer || !*peer) {
+		strcpy(dest, "*****");
+		return;
+	}
+	if (peer[0] == '"')
+		peer++;
+	len = strlen(peer);
+	if (len > 0 && peer[len - 1] == '"')
+		len--;
+	if (len >= CALL_PEER_MAX)
+		len = CALL_PEER_MAX - 1;
+	memcpy(dest, peer, len);
+	dest[len] = '\0';
+}
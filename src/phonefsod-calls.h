@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_CALLS_H
+#define _PHONEFSOD_CALLS_H
+
+#include <glib.h>
+
+/* GSM allows 7 calls at once... keep some room for stale ids */
+#define CALL_TABLE_SIZE 16
+#define CALL_PEER_MAX 48
+#define CALL_NAME_MAX 64
+
+enum CallDirection {
+	CALL_DIRECTION_INCOMING,
+	CALL_DIRECTION_OUTGOING
+};
+
+/* INCOMING -> ACTIVE <-> HELD -> RELEASE
+ * OUTGOING -> ACTIVE <-> HELD -> RELEASE
+ * and RELEASE from any state */
+enum CallState {
+	CALL_STATE_INCOMING,
+	CALL_STATE_OUTGOING,
+	CALL_STATE_ACTIVE,
+	CALL_STATE_HELD,
+	CALL_STATE_RELEASE,
+	CALL_STATE_COUNT
+};
+
+typedef struct {
+	int id;
+	gboolean used;
+	enum CallDirection direction;
+	enum CallState state;
+	char peer[CALL_PEER_MAX];
+	char name[CALL_NAME_MAX];	/* from the contacts, empty if unknown */
+	/* monotonic us when the call entered each state (0 = never) */
+	gint64 since[CALL_STATE_COUNT];
+	gboolean displayed;
+} call_t;
+
+call_t *calls_lookup(int id);
+call_t *calls_add(int id, enum CallDirection direction, const char *peer);
+gboolean calls_set_state(call_t *call, enum CallState state);
+void calls_incoming_displayed(int id);
+void calls_remove(call_t *call);
+int calls_count(enum CallDirection direction);
+int calls_total();
+GVariant *calls_to_variant();
+GVariant *calls_metrics_to_variant();
+
+#endif
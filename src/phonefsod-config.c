@@ -0,0 +1,213 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+
+/*
+ * The config store keeps the one in-memory copy of the configuration
+ * that settings changed over D-Bus go to. Changes only mark the store
+ * dirty and are written out together CONFIG_WRITE_DELAY ms after the
+ * first one, as a single g_file_set_contents (which writes a temporary
+ * file and renames it over the config). Pending changes are flushed
+ * before the config is reloaded, before suspend and on shutdown.
+ * What was written is remembered so the file monitor can tell our
+ * own writes from changes made by someone else.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "phonefsod-config.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_MAIN
+#include "phonefsod-log.h"
+
+static struct {
+	GKeyFile *keyfile;
+	char *path;
+	gboolean dirty;
+	guint changes;		/* merged into the pending write */
+	guint timeout_id;
+	gboolean written;	/* the file was written by us... */
+	GStatBuf written_stat;	/* ...and looked like this afterwards */
+} store = { NULL, NULL, FALSE, 0, 0, FALSE, { 0 } };
+
+static gboolean _write_timeout(gpointer data);
+
+gboolean
+config_load(const char *path)
+{
+	GError *error = NULL;
+	GKeyFile *keyfile;
+
+	/* don't lose what is still pending for the old one */
+	config_flush();
+
+	keyfile = g_key_file_new();
+	if (!g_key_file_load_from_file(keyfile, path,
+			G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS,
+			&error)) {
+		g_warning("config store: failed loading %s: %s",
+			  path, error->message);
+		g_error_free(error);
+		g_key_file_free(keyfile);
+		return FALSE;
+	}
+
+	if (store.keyfile)
+		g_key_file_free(store.keyfile);
+	g_free(store.path);
+	store.keyfile = keyfile;
+	store.path = g_strdup(path);
+	return TRUE;
+}
+
+static void
+_changed()
+{
+	store.dirty = TRUE;
+	store.changes++;
+	/* the delay is not restarted... a steady stream of changes
+	 * (eg. a slider) is still written every CONFIG_WRITE_DELAY ms */
+	if (store.timeout_id)
+		return;
+	store.timeout_id = g_timeout_add(CONFIG_WRITE_DELAY,
+					 _write_timeout, NULL);
+}
+
+void
+config_set_boolean(const char *group, const char *key, gboolean value)
+{
+	GError *error = NULL;
+
+	if (!store.keyfile) {
+		g_message("config store: not loaded, not saving %s", key);
+		return;
+	}
+	if (g_key_file_get_boolean(store.keyfile, group, key, &error) == value
+			&& !error) {
+		return;
+	}
+	if (error)
+		g_error_free(error);
+	g_key_file_set_boolean(store.keyfile, group, key, value);
+	_changed();
+}
+
+void
+config_set_integer(const char *group, const char *key, int value)
+{
+	GError *error = NULL;
+
+	if (!store.keyfile) {
+		g_message("config store: not loaded, not saving %s", key);
+		return;
+	}
+	if (g_key_file_get_integer(store.keyfile, group, key, &error) == value
+			&& !error) {
+		return;
+	}
+	if (error)
+		g_error_free(error);
+	g_key_file_set_integer(store.keyfile, group, key, value);
+	_changed();
+}
+
+void
+config_set_string(const char *group, const char *key, const char *value)
+{
+	char *current;
+
+	if (!store.keyfile) {
+		g_message("config store: not loaded, not saving %s", key);
+		return;
+	}
+	current = g_key_file_get_string(store.keyfile, group, key, NULL);
+	if (current && !strcmp(current, value)) {
+		g_free(current);
+		return;
+	}
+	g_free(current);
+	g_key_file_set_string(store.keyfile, group, key, value);
+	_changed();
+}
+
+void
+config_flush()
+{
+	GError *error = NULL;
+	char *config_data;
+	gsize size;
+
+	if (store.timeout_id) {
+		g_source_remove(store.timeout_id);
+		store.timeout_id = 0;
+	}
+	if (!store.dirty)
+		return;
+
+	config_data = g_key_file_to_data(store.keyfile, &size, NULL);
+	if (!config_data) {
+		g_message("could not convert config data to write it");
+		return;
+	}
+	if (!g_file_set_contents(store.path, config_data, size, &error)) {
+		g_warning("failed writing config: %s", error->message);
+		g_error_free(error);
+	}
+	else {
+		log_debug("config store: %u change(s) written", store.changes);
+		store.written = g_stat(store.path, &store.written_stat) == 0;
+	}
+	g_free(config_data);
+	/* a failed write is not retried - the next change will try again */
+	store.dirty = FALSE;
+	store.changes = 0;
+}
+
+/* whether the config file is still the one config_flush() wrote...
+ * the write replaces the file, so a change by anyone else shows in
+ * the inode, size or mtime */
+gboolean
+config_is_own_write()
+{
+	GStatBuf st;
+
+	if (!store.written || g_stat(store.path, &st) != 0)
+		return FALSE;
+	return st.st_ino == store.written_stat.st_ino &&
+		st.st_size == store.written_stat.st_size &&
+		st.st_mtime == store.written_stat.st_mtime;
+}
+
+static gboolean
+_write_timeout(gpointer data)
+{
+	(void) data;
+	store.timeout_id = 0;
+	config_flush();
+	return FALSE;
+}
+
+void
+config_shutdown()
+{
+	config_flush();
+	if (store.keyfile) {
+		g_key_file_free(store.keyfile);
+		store.keyfile = NULL;
+	}
+	g_free(store.path);
+	store.path = NULL;
+}
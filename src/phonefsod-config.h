@@ -0,0 +1,34 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+
+#ifndef _PHONEFSOD_CONFIG_H
+#define _PHONEFSOD_CONFIG_H
+
+#include <glib.h>
+
+/* ms changes are held back to merge them into a single write */
+#define CONFIG_WRITE_DELAY 2000
+
+gboolean config_load(const char *path);
+void config_set_boolean(const char *group, const char *key, gboolean value);
+void config_set_integer(const char *group, const char *key, int value);
+void config_set_string(const char *group, const char *key, const char *value);
+void config_flush();
+gboolean config_is_own_write();
+void config_shutdown();
+
+#endif
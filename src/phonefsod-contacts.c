@@ -0,0 +1,497 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+/*
+ * In-memory index of the opimd contacts for resolving caller ids
+ * without going over D-Bus while the phone rings.
+ *
+ * Numbers are stored in a trie by their digits in reverse order, so
+ * national and international notations of a number share the path of
+ * the subscriber part and only diverge at the prefix. A lookup follows
+ * the incoming number as deep as it can and takes the contact found
+ * there if it is unambiguous and enough digits matched.
+ *
+ * The index is reloaded in full whenever opimd appears on the bus, so
+ * an opimd started after us or restarted later is picked up. In
+ * between it follows NewContact, ContactUpdated and ContactDeleted.
+ */
+
+#include <string.h>
+#include <gio/gio.h>
+#include "phonefsod-contacts.h"
+#include "phonefsod-dbus-common.h"
+#include "phonefsod-globals.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_CALLS
+#include "phonefsod-log.h"
+
+/* digits that have to match for a number to be recognized...
+ * unless the whole number matched exactly */
+#define CONTACTS_MIN_MATCH_DIGITS 7
+#define CONTACTS_MAX_DIGITS 32
+
+typedef struct {
+	char *path;
+	char *name;
+	GPtrArray *numbers;	/* digits in reverse order */
+} contact_t;
+
+typedef struct _trie_node trie_node_t;
+struct _trie_node {
+	trie_node_t *child[10];
+	GSList *contacts;	/* contacts with a number ending here */
+	guint entries;		/* numbers within this subtree */
+	contact_t *match;	/* contact of all of them, NULL if several */
+};
+
+static trie_node_t *root = NULL;
+static GHashTable *contacts = NULL;	/* path -> contact_t */
+static guint new_contact_id = 0;
+static guint contact_changed_id = 0;
+static guint pim_watcher_id = 0;
+
+static void _contacts_query_callback(GObject *source, GAsyncResult *res, gpointer data);
+static void _contacts_results_callback(GObject *source, GAsyncResult *res, gpointer data);
+static void _contact_content_callback(GObject *source, GAsyncResult *res, gpointer data);
+static void _new_contact_handler(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer data);
+static void _contact_changed_handler(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer data);
+static void _on_pim_appeared(GDBusConnection *connection, const gchar *name, const gchar *name_owner, gpointer data);
+static void _on_pim_vanished(GDBusConnection *connection, const gchar *name, gpointer data);
+
+
+static int
+_reverse_digits(const char *number, char *digits)
+{
+	int len = 0, i;
+	const char *p;
+
+	for (p = number; *p && len < CONTACTS_MAX_DIGITS; p++) {
+		if (*p >= '0' && *p <= '9')
+			digits[len++] = *p;
+	}
+	for (i = 0; i < len / 2; i++) {
+		char c = digits[i];
+		digits[i] = digits[len - 1 - i];
+		digits[len - 1 - i] = c;
+	}
+	digits[len] = '\0';
+	return len;
+}
+
+/* recalculates the summary of a node from its own contacts and children */
+static void
+_trie_update(trie_node_t *node)
+{
+	contact_t *match = NULL;
+	gboolean several = FALSE;
+	GSList *l;
+	int i;
+
+	node->entries = g_slist_length(node->contacts);
+	for (l = node->contacts; l; l = l->next) {
+		contact_t *contact = l->data;
+		if (!match)
+			match = contact;
+		else if (strcmp(match->name, contact->name))
+			several = TRUE;
+	}
+	for (i = 0; i < 10; i++) {
+		trie_node_t *child = node->child[i];
+		if (!child || !child->entries)
+			continue;
+		node->entries += child->entries;
+		if (!child->match)
+			several = TRUE;
+		else if (!match)
+			match = child->match;
+		else if (strcmp(match->name, child->match->name))
+			several = TRUE;
+	}
+	node->match = several ? NULL : match;
+}
+
+static void
+_trie_insert(const char *digits, contact_t *contact)
+{
+	trie_node_t *path[CONTACTS_MAX_DIGITS + 1];
+	trie_node_t *node;
+	int depth;
+
+	if (!root)
+		root = g_slice_new0(trie_node_t);
+	node = path[0] = root;
+	for (depth = 0; digits[depth]; depth++) {
+		int d = digits[depth] - '0';
+		if (!node->child[d])
+			node->child[d] = g_slice_new0(trie_node_t);
+		node = path[depth + 1] = node->child[d];
+	}
+	node->contacts = g_slist_prepend(node->contacts, contact);
+
+	for (; depth >= 0; depth--)
+		_trie_update(path[depth]);
+}
+
+static void
+_trie_remove(const char *digits, contact_t *contact)
+{
+	trie_node_t *path[CONTACTS_MAX_DIGITS + 1];
+	trie_node_t *node;
+	int depth;
+
+	if (!root)
+		return;
+	node = path[0] = root;
+	for (depth = 0; digits[depth]; depth++) {
+		node = node->child[digits[depth] - '0'];
+		if (!node)
+			return;
+		path[depth + 1] = node;
+	}
+	node->contacts = g_slist_remove(node->contacts, contact);
+
+	/* update bottom-up and drop the nodes that became empty */
+	for (; depth >= 0; depth--) {
+		_trie_update(path[depth]);
+		if (depth > 0 && !path[depth]->entries) {
+			path[depth - 1]->child[digits[depth - 1] - '0'] = NULL;
+			g_slice_free(trie_node_t, path[depth]);
+		}
+	}
+}
+
+static void
+_trie_free(trie_node_t *node)
+{
+	int i;
+
+	if (!node)
+		return;
+	for (i = 0; i < 10; i++)
+		_trie_free(node->child[i]);
+	g_slist_free(node->contacts);
+	g_slice_free(trie_node_t, node);
+}
+
+static void
+_contact_free(gpointer data)
+{
+	contact_t *contact = data;
+	guint i;
+
+	for (i = 0; i < contact->numbers->len; i++)
+		_trie_remove(g_ptr_array_index(contact->numbers, i), contact);
+	g_ptr_array_free(contact->numbers, TRUE);
+	g_free(contact->path);
+	g_free(contact->name);
+	g_free(contact);
+}
+
+static void
+_contact_add_number(contact_t *contact, const char *number)
+{
+	char digits[CONTACTS_MAX_DIGITS + 1];
+
+	if (g_str_has_prefix(number, "tel:"))
+		number += 4;
+	if (!_reverse_digits(number, digits))
+		return;
+	g_ptr_array_add(contact->numbers, g_strdup(digits));
+	_trie_insert(digits, contact);
+}
+
+/* (re)indexes a contact from its opimd fields */
+static void
+_contact_update(const char *path, GVariant *fields)
+{
+	contact_t *contact;
+	GVariantIter iter;
+	const gchar *key;
+	GVariant *value;
+	const gchar *name = NULL, *surname = NULL;
+
+	g_variant_lookup(fields, "Name", "&s", &name);
+	g_variant_lookup(fields, "Surname", "&s", &surname);
+	if (!name && !surname) {
+		g_hash_table_remove(contacts, path);
+		return;
+	}
+
+	contact = g_new0(contact_t, 1);
+	contact->path = g_strdup(path);
+	if (name && surname)
+		contact->name = g_strdup_printf("%s %s", name, surname);
+	else
+		contact->name = g_strdup(name ? name : surname);
+	contact->numbers = g_ptr_array_new_with_free_func(g_free);
+	/* replacing drops the old numbers from the trie */
+	g_hash_table_replace(contacts, contact->path, contact);
+
+	/* every field that looks like a phone number is taken */
+	g_variant_iter_init(&iter, fields);
+	while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+		gchar *lower = g_ascii_strdown(key, -1);
+		gboolean is_phone = strstr(lower, "phone") != NULL;
+		g_free(lower);
+		if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+			const gchar *s = g_variant_get_string(value, NULL);
+			if (is_phone || g_str_has_prefix(s, "tel:"))
+				_contact_add_number(contact, s);
+		}
+		else if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING_ARRAY)) {
+			GVariantIter i;
+			const gchar *s;
+			g_variant_iter_init(&i, value);
+			while (g_variant_iter_next(&i, "&s", &s)) {
+				if (is_phone || g_str_has_prefix(s, "tel:"))
+					_contact_add_number(contact, s);
+			}
+		}
+		g_variant_unref(value);
+	}
+}
+
+static void
+_contacts_load()
+{
+	GVariantBuilder query;
+
+	/* an empty query gives us all contacts */
+	log_debug("loading contacts for caller identification");
+	g_variant_builder_init(&query, G_VARIANT_TYPE("a{sv}"));
+	g_dbus_connection_call(system_bus, FSO_PIM_SERVICE,
+			       FSO_PIM_CONTACTS_PATH, FSO_PIM_CONTACTS_IFACE,
+			       "Query", g_variant_new("(a{sv})", &query),
+			       NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+			       _contacts_query_callback, NULL);
+}
+
+void
+contacts_init()
+{
+	if (contacts)
+		return;
+	contacts = g_hash_table_new_full(g_str_hash, g_str_equal,
+					 NULL, _contact_free);
+
+	new_contact_id = g_dbus_connection_signal_subscribe
+		(system_bus, FSO_PIM_SERVICE, FSO_PIM_CONTACTS_IFACE,
+		 "NewContact", FSO_PIM_CONTACTS_PATH, NULL,
+		 G_DBUS_SIGNAL_FLAGS_NONE, _new_contact_handler, NULL, NULL);
+	contact_changed_id = g_dbus_connection_signal_subscribe
+		(system_bus, FSO_PIM_SERVICE, FSO_PIM_CONTACT_IFACE,
+		 NULL, NULL, NULL,
+		 G_DBUS_SIGNAL_FLAGS_NONE, _contact_changed_handler, NULL, NULL);
+
+	/* the contacts are loaded as soon as opimd is there */
+	pim_watcher_id = g_bus_watch_name_on_connection
+		(system_bus, FSO_PIM_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE,
+		 _on_pim_appeared, _on_pim_vanished, NULL, NULL);
+}
+
+void
+contacts_shutdown()
+{
+	if (!contacts)
+		return;
+	g_bus_unwatch_name(pim_watcher_id);
+	pim_watcher_id = 0;
+	g_dbus_connection_signal_unsubscribe(system_bus, new_contact_id);
+	g_dbus_connection_signal_unsubscribe(system_bus, contact_changed_id);
+	g_hash_table_destroy(contacts);
+	contacts = NULL;
+	_trie_free(root);
+	root = NULL;
+}
+
+/* returns the name of the contact the number belongs to or NULL */
+const char *
+contacts_lookup(const char *number)
+{
+	char digits[CONTACTS_MAX_DIGITS + 1];
+	trie_node_t *node = root;
+	int len, depth;
+
+	if (!node || !number)
+		return NULL;
+
+	len = _reverse_digits(number, digits);
+	for (depth = 0; depth < len; depth++) {
+		trie_node_t *next = node->child[digits[depth] - '0'];
+		if (!next || !next->entries)
+			break;
+		node = next;
+	}
+
+	if (depth < CONTACTS_MIN_MATCH_DIGITS &&
+			!(depth == len && node->contacts)) {
+		return NULL;
+	}
+	return node->match ? node->match->name : NULL;
+}
+
+
+/* g_bus_watch_name callbacks */
+static void
+_on_pim_appeared(GDBusConnection *connection, const gchar *name,
+		 const gchar *name_owner, gpointer data)
+{
+	(void) connection;
+	(void) data;
+	log_debug("%s is on the bus (%s)", name, name_owner);
+	/* a restarted opimd might have changed anything... start over */
+	g_hash_table_remove_all(contacts);
+	_contacts_load();
+}
+
+static void
+_on_pim_vanished(GDBusConnection *connection, const gchar *name,
+		 gpointer data)
+{
+	(void) connection;
+	(void) data;
+	/* the index is kept... it is still good for caller ids */
+	log_debug("%s is not on the bus", name);
+}
+
+
+/* dbus callbacks */
+static void
+_contacts_query_callback(GObject *source, GAsyncResult *res, gpointer data)
+{
+	GError *error = NULL;
+	GVariant *ret, *path;
+
+	ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+	if (error) {
+		g_warning("failed querying contacts: %s", error->message);
+		g_error_free(error);
+		return;
+	}
+
+	path = g_variant_get_child_value(ret, 0);
+	g_dbus_connection_call(system_bus, FSO_PIM_SERVICE,
+			       g_variant_get_string(path, NULL),
+			       FSO_PIM_CONTACT_QUERY_IFACE, "GetMultipleResults",
+			       g_variant_new("(i)", -1), G_VARIANT_TYPE("(aa{sv})"),
+			       G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+			       _contacts_results_callback,
+			       g_strdup(g_variant_get_string(path, NULL)));
+	g_variant_unref(path);
+	g_variant_unref(ret);
+}
+
+static void
+_contacts_results_callback(GObject *source, GAsyncResult *res, gpointer data)
+{
+	char *query_path = data;
+	GError *error = NULL;
+	GVariant *ret, *results, *fields;
+	GVariantIter iter;
+
+	ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+	/* the query is not needed anymore in any case */
+	g_dbus_connection_call(system_bus, FSO_PIM_SERVICE, query_path,
+			       FSO_PIM_CONTACT_QUERY_IFACE, "Dispose", NULL,
+			       NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+	g_free(query_path);
+	if (error) {
+		g_warning("failed getting contacts: %s", error->message);
+		g_error_free(error);
+		return;
+	}
+	if (!contacts) {
+		g_variant_unref(ret);
+		return;
+	}
+
+	results = g_variant_get_child_value(ret, 0);
+	g_variant_iter_init(&iter, results);
+	while ((fields = g_variant_iter_next_value(&iter))) {
+		const gchar *path;
+		if (g_variant_lookup(fields, "Path", "&s", &path))
+			_contact_update(path, fields);
+		g_variant_unref(fields);
+	}
+	g_message("indexed %u contacts for caller identification",
+		  g_hash_table_size(contacts));
+	g_variant_unref(results);
+	g_variant_unref(ret);
+}
+
+static void
+_contact_content_callback(GObject *source, GAsyncResult *res, gpointer data)
+{
+	char *path = data;
+	GError *error = NULL;
+	GVariant *ret, *fields;
+
+	ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+	if (error) {
+		g_warning("failed getting contact %s: %s", path, error->message);
+		g_error_free(error);
+		g_free(path);
+		return;
+	}
+
+	if (contacts) {
+		fields = g_variant_get_child_value(ret, 0);
+		_contact_update(path, fields);
+		g_variant_unref(fields);
+	}
+	g_variant_unref(ret);
+	g_free(path);
+}
+
+static void
+_fetch_contact(const char *path)
+{
+	g_dbus_connection_call(system_bus, FSO_PIM_SERVICE, path,
+			       FSO_PIM_CONTACT_IFACE, "GetContent", NULL,
+			       G_VARIANT_TYPE("(a{sv})"), G_DBUS_CALL_FLAGS_NONE,
+			       -1, NULL, _contact_content_callback, g_strdup(path));
+}
+
+
+/* dbus signal handlers */
+static void
+_new_contact_handler(GDBusConnection *connection, const gchar *sender,
+		     const gchar *object_path, const gchar *interface_name,
+		     const gchar *signal_name, GVariant *parameters,
+		     gpointer data)
+{
+	GVariant *path = g_variant_get_child_value(parameters, 0);
+
+	log_debug("new contact %s", g_variant_get_string(path, NULL));
+	_fetch_contact(g_variant_get_string(path, NULL));
+	g_variant_unref(path);
+}
+
+static void
+_contact_changed_handler(GDBusConnection *connection, const gchar *sender,
+			 const gchar *object_path, const gchar *interface_name,
+			 const gchar *signal_name, GVariant *parameters,
+			 gpointer data)
+{
+	if (!strcmp(signal_name, "ContactDeleted")) {
+		log_debug("contact %s deleted", object_path);
+		g_hash_table_remove(contacts, object_path);
+	}
+	else if (!strcmp(signal_name, "ContactUpdated")) {
+		/* the signal carries only the changed fields */
+		log_debug("contact %s updated", object_path);
+		_fetch_contact(object_path);
+	}
+}
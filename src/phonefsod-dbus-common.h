@@ -23,6 +23,8 @@
 
 #define PHONEFSOD_USAGE_INTERFACE            PHONEFSOD_SERVICE ".Usage"
 #define PHONEFSOD_USAGE_PATH                 PHONEFSOD_PATH "/Usage"
+#define PHONEFSOD_DIAGNOSTICS_INTERFACE      PHONEFSOD_SERVICE ".Diagnostics"
+#define PHONEFSOD_SETTINGS_INTERFACE         PHONEFSOD_SERVICE ".Settings"
 
 /* phoneuid */
 #define PHONEUID_SERVICE                     "org.shr.phoneui"
@@ -63,6 +65,10 @@
 #define FSO_PIM_SERVICE                      "org.freesmartphone.opimd"
 #define FSO_PIM_MESSAGES_PATH                "/org/freesmartphone/PIM/Messages"
 #define FSO_PIM_MESSAGES_IFACE               "org.freesmartphone.PIM.Messages"
+#define FSO_PIM_CONTACTS_PATH                "/org/freesmartphone/PIM/Contacts"
+#define FSO_PIM_CONTACTS_IFACE               "org.freesmartphone.PIM.Contacts"
+#define FSO_PIM_CONTACT_IFACE                "org.freesmartphone.PIM.Contact"
+#define FSO_PIM_CONTACT_QUERY_IFACE          "org.freesmartphone.PIM.ContactQuery"
 
 #define FSO_DEVICE_SERVICE                   "org.freesmartphone.odeviced"
 #define FSO_DEVICE_IDLE_NOTIFIER_PATH        "/org/freesmartphone/Device/IdleNotifier/0"
@@ -14,6 +14,7 @@
  *  GNU Lesser Public License for more details.
  */
 
+#include <errno.h>
 #include <string.h>
 #include <gio/gio.h>
 #include <shr-bindings.h>
@@ -21,11 +22,125 @@
 #include "phonefsod-dbus-common.h"
 #include "phonefsod-fso.h"
 #include "phonefsod-globals.h"
+#include "phonefsod-ready.h"
+#include "phonefsod-timeline.h"
+#include "phonefsod-retry.h"
+#include "phonefsod-calls.h"
+#include "phonefsod-wake.h"
+#include "phonefsod-recorder.h"
+#include "phonefsod-config.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_DBUS
+#include "phonefsod-log.h"
 
 static guint phonefsod_owner_id = 0;
 static guint phoneuid_watcher_id = 0;
+static guint diagnostics_registration_id = 0;
+static guint settings_registration_id = 0;
 static PhonefsoUsage *usage;
 
+/* what phoneui currently shows as far as we know... set when a
+ * call is issued, confirmed by its callback and forgotten when it
+ * fails or phoneui might have changed it on its own */
+enum PhoneuiVisibility {
+	PHONEUI_UNKNOWN = -1,
+	PHONEUI_HIDDEN,
+	PHONEUI_SHOWN
+};
+static struct {
+	enum PhoneuiVisibility idle_screen;
+	enum PhoneuiVisibility screensaver;
+	guint skipped;
+} phoneui_visible = { PHONEUI_UNKNOWN, PHONEUI_UNKNOWN, 0 };
+
+/* org.shr.phonefso.Diagnostics is not part of the generated bindings
+ * so it is exported next to the Usage interface by hand */
+static const gchar diagnostics_introspection_xml[] =
+	"<node>"
+	"  <interface name='" PHONEFSOD_DIAGNOSTICS_INTERFACE "'>"
+	"    <method name='GetStartupTimeline'>"
+	"      <arg type='a(sx)' name='timeline' direction='out'/>"
+	"    </method>"
+	"    <method name='GetRetryCounters'>"
+	"      <arg type='a(suuu)' name='counters' direction='out'/>"
+	"    </method>"
+	"    <method name='GetReregisterStats'>"
+	"      <arg type='a{sx}' name='stats' direction='out'/>"
+	"    </method>"
+	"    <method name='ListCalls'>"
+	"      <arg type='a(issssxx)' name='calls' direction='out'/>"
+	"    </method>"
+	"    <method name='GetCallMetrics'>"
+	"      <arg type='a(suxxxau)' name='histograms' direction='out'/>"
+	"    </method>"
+	"    <method name='GetBrightnessStats'>"
+	"      <arg type='a{sx}' name='stats' direction='out'/>"
+	"    </method>"
+	"    <method name='GetSuspendEligibility'>"
+	"      <arg type='b' name='eligible' direction='out'/>"
+	"      <arg type='s' name='blocker' direction='out'/>"
+	"    </method>"
+	"    <method name='GetSuspendMetrics'>"
+	"      <arg type='a(suxxxau)' name='histograms' direction='out'/>"
+	"    </method>"
+	"    <method name='GetStartupInhibit'>"
+	"      <arg type='b' name='active' direction='out'/>"
+	"      <arg type='x' name='remaining_ms' direction='out'/>"
+	"    </method>"
+	"    <method name='GetWakeStats'>"
+	"      <arg type='a{sx}' name='stats' direction='out'/>"
+	"    </method>"
+	"    <method name='DumpFlightRecorder'>"
+	"      <arg type='s' name='path' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+/* org.shr.phonefso.Settings has the settings of the Usage interface as
+ * properties... clients get PropertiesChanged instead of polling */
+static const gchar settings_introspection_xml[] =
+	"<node>"
+	"  <interface name='" PHONEFSOD_SETTINGS_INTERFACE "'>"
+	"    <property type='b' name='OfflineMode' access='readwrite'/>"
+	"    <property type='i' name='DefaultBrightness' access='readwrite'/>"
+	"    <property type='i' name='MinimumBrightness' access='read'/>"
+	"    <property type='s' name='DimScreen' access='read'/>"
+	"    <property type='s' name='AutoSuspend' access='read'/>"
+	"    <property type='b' name='ShowIncomingSms' access='read'/>"
+	"    <property type='s' name='CallingIdentification' access='read'/>"
+	"    <property type='i' name='ReregisterTimeout' access='read'/>"
+	"    <property type='s' name='PdpApn' access='read'/>"
+	"    <property type='s' name='PdpUser' access='read'/>"
+	"  </interface>"
+	"</node>";
+
+static GVariant *_offline_mode_value();
+static GVariant *_default_brightness_value();
+static GVariant *_minimum_brightness_value();
+static GVariant *_dim_screen_value();
+static GVariant *_auto_suspend_value();
+static GVariant *_show_incoming_sms_value();
+static GVariant *_calling_identification_value();
+static GVariant *_reregister_timeout_value();
+static GVariant *_pdp_apn_value();
+static GVariant *_pdp_user_value();
+
+static struct {
+	const char *name;
+	GVariant *(*value)();
+	GVariant *emitted;	/* what clients have seen last */
+} settings[] = {
+	{ "OfflineMode", _offline_mode_value, NULL },
+	{ "DefaultBrightness", _default_brightness_value, NULL },
+	{ "MinimumBrightness", _minimum_brightness_value, NULL },
+	{ "DimScreen", _dim_screen_value, NULL },
+	{ "AutoSuspend", _auto_suspend_value, NULL },
+	{ "ShowIncomingSms", _show_incoming_sms_value, NULL },
+	{ "CallingIdentification", _calling_identification_value, NULL },
+	{ "ReregisterTimeout", _reregister_timeout_value, NULL },
+	{ "PdpApn", _pdp_apn_value, NULL },
+	{ "PdpUser", _pdp_user_value, NULL },
+};
+
 /* phonefso - dbus method handlers */
 static gboolean _set_offline_mode(PhonefsoUsage *object, GDBusMethodInvocation *invocation, gboolean state, gpointer user_data);
 static gboolean _get_offline_mode(PhonefsoUsage *object, GDBusMethodInvocation *invocation, gpointer user_data);
@@ -34,11 +149,30 @@ static gboolean _get_default_brightness(PhonefsoUsage *object, GDBusMethodInvoca
 static gboolean _set_pdp_credentials(PhonefsoUsage *object, GDBusMethodInvocation *invocation, const char *apn, const char *user, const char *password, gpointer user_data);
 static gboolean _set_pin(PhonefsoUsage *object, GDBusMethodInvocation *invocation, const char *pin, gboolean save, gpointer user_data);
 
+/* phonefso diagnostics - dbus method handler */
+static void _diagnostics_method_call(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, gpointer user_data);
+
+static const GDBusInterfaceVTable diagnostics_vtable = {
+	_diagnostics_method_call,
+	NULL,
+	NULL
+};
+
+/* phonefso settings - dbus property handlers */
+static GVariant *_settings_get_property(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *property_name, GError **error, gpointer user_data);
+static gboolean _settings_set_property(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *property_name, GVariant *value, GError **error, gpointer user_data);
+
+static const GDBusInterfaceVTable settings_vtable = {
+	NULL,
+	_settings_get_property,
+	_settings_set_property
+};
+
+static void _apply_offline_mode(gboolean state);
+static void _apply_default_brightness(int brightness);
+
 
 /* private helper functions */
-static void _write_pdp_credentials_to_config(void);
-static void _write_default_brightness_to_config(void);
-static void _write_offline_mode_to_config(void);
 
 /* g_bus_own_name callbacks */
 static void _on_name_acquired (GDBusConnection *connection, const gchar *name, gpointer user_data);
@@ -57,8 +191,12 @@ _on_bus_acquired (GDBusConnection *connection)
 {
         /* This is where we'd export some objects on the bus */
         GError *error = NULL;
+        GDBusNodeInfo *diagnostics_info;
+        GDBusNodeInfo *settings_info;
+        guint i;
 
-        g_debug("Yo, on the bus :-) (%s)", g_dbus_connection_get_unique_name(connection));
+        timeline_mark(MILESTONE_BUS_ACQUIRED);
+        log_debug("Yo, on the bus :-) (%s)", g_dbus_connection_get_unique_name(connection));
 
         usage = phonefso_usage_skeleton_new();
         g_signal_connect(usage, "handle-set-offline-mode", G_CALLBACK(_set_offline_mode), NULL);
@@ -77,6 +215,34 @@ _on_bus_acquired (GDBusConnection *connection)
         if (error) {
                 g_critical("Failed to register %s: %s", PHONEFSOD_USAGE_PATH, error->message);
                 g_error_free(error);
+                error = NULL;
+        }
+
+        diagnostics_info = g_dbus_node_info_new_for_xml
+                (diagnostics_introspection_xml, NULL);
+        diagnostics_registration_id = g_dbus_connection_register_object
+                (connection, PHONEFSOD_USAGE_PATH,
+                 diagnostics_info->interfaces[0], &diagnostics_vtable,
+                 NULL, NULL, &error);
+        g_dbus_node_info_unref(diagnostics_info);
+        if (error) {
+                g_critical("Failed to register %s: %s", PHONEFSOD_DIAGNOSTICS_INTERFACE, error->message);
+                g_error_free(error);
+                error = NULL;
+        }
+
+        for (i = 0; i < G_N_ELEMENTS(settings); i++)
+                settings[i].emitted = g_variant_ref_sink(settings[i].value());
+        settings_info = g_dbus_node_info_new_for_xml
+                (settings_introspection_xml, NULL);
+        settings_registration_id = g_dbus_connection_register_object
+                (connection, PHONEFSOD_USAGE_PATH,
+                 settings_info->interfaces[0], &settings_vtable,
+                 NULL, NULL, &error);
+        g_dbus_node_info_unref(settings_info);
+        if (error) {
+                g_critical("Failed to register %s: %s", PHONEFSOD_SETTINGS_INTERFACE, error->message);
+                g_error_free(error);
         }
 }
 
@@ -114,6 +280,21 @@ phonefsod_dbus_setup()
 void
 phonefsod_dbus_shutdown()
 {
+	guint i;
+
+	fso_shutdown();
+	if (diagnostics_registration_id)
+		g_dbus_connection_unregister_object(system_bus,
+						diagnostics_registration_id);
+	if (settings_registration_id)
+		g_dbus_connection_unregister_object(system_bus,
+						settings_registration_id);
+	for (i = 0; i < G_N_ELEMENTS(settings); i++) {
+		if (settings[i].emitted) {
+			g_variant_unref(settings[i].emitted);
+			settings[i].emitted = NULL;
+		}
+	}
 	g_bus_unown_name(phonefsod_owner_id);
 	g_object_unref(system_bus);
 }
@@ -127,6 +308,7 @@ _on_name_acquired (GDBusConnection *connection,
 		    gpointer         user_data)
 {
 	g_debug ("Acquired the name %s on the system bus\n", name);
+	phonefsod_ready_set(READY_BUS_NAME);
 }
 
 static void
@@ -148,7 +330,9 @@ _on_phoneuid_appeared(GDBusConnection *connection,
 {
         GError *error = NULL;
   
-	g_debug("yeah, phoneuid is on the bus (%s)", name_owner);
+	log_debug("yeah, phoneuid is on the bus (%s)", name_owner);
+	phoneui_visible.idle_screen = PHONEUI_UNKNOWN;
+	phoneui_visible.screensaver = PHONEUI_UNKNOWN;
 
         phoneui.notification = phoneui_notification_proxy_new_sync
                 (system_bus, G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
@@ -194,6 +378,8 @@ _on_phoneuid_vanished(GDBusConnection *connection,
 			 gpointer user_data)
 {
 	g_message("!!! ouch, phoneuid is gone - telephony won't work anymore !!!");
+	phoneui_visible.idle_screen = PHONEUI_UNKNOWN;
+	phoneui_visible.screensaver = PHONEUI_UNKNOWN;
 }
 
 
@@ -205,11 +391,7 @@ _set_offline_mode(PhonefsoUsage *object,
 		gboolean state,
 		gpointer user_data)
 {
-	if (offline_mode ^ state) {
-		offline_mode = state;
-		_write_offline_mode_to_config();
-		fso_set_functionality();
-	}
+	_apply_offline_mode(state);
 
 	phonefso_usage_complete_set_offline_mode(object, invocation);
 
@@ -232,9 +414,7 @@ _set_default_brightness(PhonefsoUsage *object,
 			   int brightness,
 			   gpointer user_data)
 {
-	default_brightness = brightness;
-	_write_default_brightness_to_config();
-	fso_dimit(100, DIM_SCREEN_ALWAYS);
+	_apply_default_brightness(brightness);
 
 	phonefso_usage_complete_set_default_brightness(object, invocation);
 }
@@ -268,8 +448,11 @@ _set_pdp_credentials(PhonefsoUsage *object,
 		free(pdp_password);
 	}
 	pdp_password = strdup(password);
-	_write_pdp_credentials_to_config();
+	config_set_string("gsm", "pdp_apn", pdp_apn);
+	config_set_string("gsm", "pdp_user", pdp_user);
+	config_set_string("gsm", "pdp_password", pdp_password);
 	fso_pdp_set_credentials();
+	phonefsod_settings_changed();
 
 	phonefso_usage_complete_set_pdp_credentials(object, invocation);
 
@@ -297,115 +480,323 @@ _set_pin(PhonefsoUsage *object,
 	return TRUE;
 }
 
-
-/* private helpers */
-
 static void
-_write_offline_mode_to_config(void)
+_diagnostics_method_call(GDBusConnection *connection,
+			 const gchar *sender,
+			 const gchar *object_path,
+			 const gchar *interface_name,
+			 const gchar *method_name,
+			 GVariant *parameters,
+			 GDBusMethodInvocation *invocation,
+			 gpointer user_data)
 {
-	GError *error = NULL;
-	GKeyFile *keyfile;
-	GKeyFileFlags flags;
-	gsize size;
-	char *config_data;
-
-	keyfile = g_key_file_new();
-	flags = G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS;
-	if (g_key_file_load_from_file
-		(keyfile, PHONEFSOD_CONFIG, flags, &error)) {
-		g_key_file_set_boolean(keyfile, "gsm",
-					  "offline_mode", offline_mode);
-		config_data = g_key_file_to_data(keyfile, &size, NULL);
-	if (!config_data) {
-		g_message("could not convert config data to write \
-		offline mode to config");
+	if (!strcmp(method_name, "GetStartupTimeline")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a(sx))", timeline_to_variant()));
 	}
-	else {
-		if (!g_file_set_contents(PHONEFSOD_CONFIG, config_data,
-			size, &error))
-		{
-			g_warning("failed writing offline mode \
-			to config: %s", error->message);
-			g_error_free(error);
+	else if (!strcmp(method_name, "GetRetryCounters")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a(suuu))", retry_to_variant()));
+	}
+	else if (!strcmp(method_name, "GetReregisterStats")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a{sx})", fso_reregister_stats_to_variant()));
+	}
+	else if (!strcmp(method_name, "ListCalls")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a(issssxx))", calls_to_variant()));
+	}
+	else if (!strcmp(method_name, "GetCallMetrics")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a(suxxxau))", calls_metrics_to_variant()));
+	}
+	else if (!strcmp(method_name, "GetBrightnessStats")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a{sx})", fso_brightness_stats_to_variant()));
+	}
+	else if (!strcmp(method_name, "GetSuspendEligibility")) {
+		g_dbus_method_invocation_return_value(invocation,
+			fso_suspend_eligibility_to_variant());
+	}
+	else if (!strcmp(method_name, "GetSuspendMetrics")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a(suxxxau))", fso_suspend_metrics_to_variant()));
+	}
+	else if (!strcmp(method_name, "GetStartupInhibit")) {
+		g_dbus_method_invocation_return_value(invocation,
+			fso_startup_inhibit_to_variant());
+	}
+	else if (!strcmp(method_name, "GetWakeStats")) {
+		g_dbus_method_invocation_return_value(invocation,
+			g_variant_new("(@a{sx})", wake_stats_to_variant()));
+	}
+	else if (!strcmp(method_name, "DumpFlightRecorder")) {
+		if (recorder_dump(recorder_dump_file())) {
+			g_dbus_method_invocation_return_value(invocation,
+				g_variant_new("(s)", recorder_dump_file()));
 		}
-		g_free(config_data);
+		else {
+			g_dbus_method_invocation_return_error(invocation,
+				G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+				"failed writing %s: %s", recorder_dump_file(),
+				g_strerror(errno));
+		}
+	}
+	else {
+		g_dbus_method_invocation_return_error(invocation,
+			G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+			"Unknown method %s", method_name);
+	}
+}
+
+static GVariant *
+_settings_get_property(GDBusConnection *connection,
+		       const gchar *sender,
+		       const gchar *object_path,
+		       const gchar *interface_name,
+		       const gchar *property_name,
+		       GError **error,
+		       gpointer user_data)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(settings); i++) {
+		if (!strcmp(property_name, settings[i].name))
+			return settings[i].value();
+	}
+	g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+		    "Unknown property %s", property_name);
+	return NULL;
+}
+
+static gboolean
+_settings_set_property(GDBusConnection *connection,
+		       const gchar *sender,
+		       const gchar *object_path,
+		       const gchar *interface_name,
+		       const gchar *property_name,
+		       GVariant *value,
+		       GError **error,
+		       gpointer user_data)
+{
+	if (!strcmp(property_name, "OfflineMode")) {
+		_apply_offline_mode(g_variant_get_boolean(value));
 	}
+	else if (!strcmp(property_name, "DefaultBrightness")) {
+		_apply_default_brightness(g_variant_get_int32(value));
+	}
+	else {
+		g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_PROPERTY_READ_ONLY,
+			    "Property %s is read-only", property_name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* compares all settings against what was emitted last... so it can
+ * be called after anything that might have changed some of them */
+void
+phonefsod_settings_changed()
+{
+	GVariantBuilder changed;
+	GVariant *value;
+	gboolean any = FALSE;
+	guint i;
+
+	if (!settings_registration_id)
+		return;
+
+	g_variant_builder_init(&changed, G_VARIANT_TYPE("a{sv}"));
+	for (i = 0; i < G_N_ELEMENTS(settings); i++) {
+		value = g_variant_ref_sink(settings[i].value());
+		if (g_variant_equal(value, settings[i].emitted)) {
+			g_variant_unref(value);
+			continue;
 		}
+		g_variant_builder_add(&changed, "{sv}",
+				      settings[i].name, value);
+		g_variant_unref(settings[i].emitted);
+		settings[i].emitted = value;
+		any = TRUE;
+	}
+	if (!any) {
+		g_variant_builder_clear(&changed);
+		return;
+	}
 
-		if (keyfile)
-			g_key_file_free(keyfile);
+	g_dbus_connection_emit_signal(system_bus, NULL, PHONEFSOD_USAGE_PATH,
+			"org.freedesktop.DBus.Properties", "PropertiesChanged",
+			g_variant_new("(s@a{sv}@as)", PHONEFSOD_SETTINGS_INTERFACE,
+				      g_variant_builder_end(&changed),
+				      g_variant_new_strv(NULL, 0)), NULL);
 }
 
+
+/* private helpers */
+
 static void
-_write_default_brightness_to_config(void)
+_apply_offline_mode(gboolean state)
 {
-	GError *error = NULL;
-	GKeyFile *keyfile;
-	GKeyFileFlags flags;
-	gsize size;
-	char *config_data;
-
-	keyfile = g_key_file_new();
-	flags = G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS;
-	if (g_key_file_load_from_file
-		(keyfile, PHONEFSOD_CONFIG, flags, &error)) {
-		g_key_file_set_integer(keyfile, "idle",
-					  "default_brightness", default_brightness);
-		config_data = g_key_file_to_data(keyfile, &size, NULL);
-		if (!config_data) {
-			g_message("could not convert config data to write \
-			default brightness to config");
-		}
-		else {
-			if (!g_file_set_contents(PHONEFSOD_CONFIG, config_data,
-				size, &error))
-			{
-				g_warning("failed writing default brightness \
-				to config: %s", error->message);
-				g_error_free(error);
-			}
-			g_free(config_data);
-		}
+	if (offline_mode ^ state) {
+		offline_mode = state;
+		config_set_boolean("gsm", "offline_mode", offline_mode);
+		fso_set_functionality();
+		phonefsod_settings_changed();
 	}
-	if (keyfile)
-		g_key_file_free(keyfile);
 }
 
 static void
-_write_pdp_credentials_to_config(void)
+_apply_default_brightness(int brightness)
 {
-	GError *error = NULL;
-	GKeyFile *keyfile;
-	GKeyFileFlags flags;
-	gsize size;
-	char *config_data;
-
-	keyfile = g_key_file_new();
-	flags = G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS;
-	if (g_key_file_load_from_file
-		(keyfile, PHONEFSOD_CONFIG, flags, &error)) {
-		g_key_file_set_string(keyfile, "gsm", "pdp_apn", pdp_apn);
-	g_key_file_set_string(keyfile, "gsm", "pdp_user", pdp_user);
-	g_key_file_set_string(keyfile, "gsm", "pdp_password", pdp_password);
-	config_data = g_key_file_to_data(keyfile, &size, NULL);
-	if (!config_data) {
-		g_message("could not convert config data to write \
-		default brightness to config");
+	default_brightness = brightness;
+	config_set_integer("idle", "default_brightness", default_brightness);
+	fso_dimit(100, DIM_SCREEN_ALWAYS);
+	phonefsod_settings_changed();
+}
+
+/* current values of the Settings properties */
+static GVariant *
+_offline_mode_value()
+{
+	return g_variant_new_boolean(offline_mode);
+}
+
+static GVariant *
+_default_brightness_value()
+{
+	return g_variant_new_int32(default_brightness);
+}
+
+static GVariant *
+_minimum_brightness_value()
+{
+	return g_variant_new_int32(minimum_brightness);
+}
+
+static GVariant *
+_dim_screen_value()
+{
+	switch (dim_screen) {
+	case DIM_SCREEN_NEVER:
+		return g_variant_new_string("never");
+	case DIM_SCREEN_ONBAT:
+		return g_variant_new_string("onbat");
+	default:
+		return g_variant_new_string("always");
+	}
+}
+
+static GVariant *
+_auto_suspend_value()
+{
+	switch (auto_suspend) {
+	case SUSPEND_NEVER:
+		return g_variant_new_string("never");
+	case SUSPEND_ALWAYS:
+		return g_variant_new_string("always");
+	default:
+		return g_variant_new_string("normal");
+	}
+}
+
+static GVariant *
+_show_incoming_sms_value()
+{
+	return g_variant_new_boolean(show_incoming_sms);
+}
+
+static GVariant *
+_calling_identification_value()
+{
+	switch (calling_identification) {
+	case FREE_SMARTPHONE_GSM_CALLING_IDENTIFICATION_STATUS_ON:
+		return g_variant_new_string("on");
+	case FREE_SMARTPHONE_GSM_CALLING_IDENTIFICATION_STATUS_OFF:
+		return g_variant_new_string("off");
+	default:
+		return g_variant_new_string("network");
+	}
+}
+
+static GVariant *
+_reregister_timeout_value()
+{
+	return g_variant_new_int32(gsm_reregister_timeout);
+}
+
+static GVariant *
+_pdp_apn_value()
+{
+	return g_variant_new_string(pdp_apn ? pdp_apn : "");
+}
+
+static GVariant *
+_pdp_user_value()
+{
+	return g_variant_new_string(pdp_user ? pdp_user : "");
+}
+
+/* phoneuid - calls skipped when they would not change anything */
+
+void
+phonefsod_idle_screen_show()
+{
+	if (phoneui_visible.idle_screen == PHONEUI_SHOWN) {
+		log_debug("idle screen is already shown");
+		phoneui_visible.skipped++;
+		return;
+	}
+	phoneui_visible.idle_screen = PHONEUI_SHOWN;
+	phoneui_idle_screen_call_display
+		(phoneui.idle_screen, NULL, phoneui_show_idle_cb, NULL);
+}
+
+void
+phonefsod_idle_screen_toggle()
+{
+	if (phoneui_visible.idle_screen != PHONEUI_UNKNOWN) {
+		phoneui_visible.idle_screen =
+			phoneui_visible.idle_screen == PHONEUI_SHOWN ?
+			PHONEUI_HIDDEN : PHONEUI_SHOWN;
+	}
+	phoneui_idle_screen_call_toggle
+		(phoneui.idle_screen, NULL, phoneui_toggle_idle_cb, NULL);
+}
+
+/* the user can hide the idle screen without us noticing */
+void
+phonefsod_idle_screen_invalidate()
+{
+	phoneui_visible.idle_screen = PHONEUI_UNKNOWN;
+}
+
+void
+phonefsod_screensaver_set(gboolean active)
+{
+	enum PhoneuiVisibility wanted =
+		active ? PHONEUI_SHOWN : PHONEUI_HIDDEN;
+
+	if (phoneui_visible.screensaver == wanted) {
+		phoneui_visible.skipped++;
+		return;
+	}
+	phoneui_visible.screensaver = wanted;
+	if (active) {
+		phoneui_idle_screen_call_activate_screensaver
+			(phoneui.idle_screen, NULL,
+			 phoneui_activate_screensaver_cb, NULL);
 	}
 	else {
-		if (!g_file_set_contents(PHONEFSOD_CONFIG, config_data,
-			size, &error))
-		{
-			g_warning("failed writing pdp credentials \
-			to config: %s", error->message);
-			g_error_free(error);
-		}
-		g_free(config_data);
+		phoneui_idle_screen_call_deactivate_screensaver
+			(phoneui.idle_screen, NULL,
+			 phoneui_deactivate_screensaver_cb, NULL);
 	}
-		}
+}
 
-		if (keyfile)
-			g_key_file_free(keyfile);
+guint
+phonefsod_phoneui_calls_skipped()
+{
+	return phoneui_visible.skipped;
 }
 
 
@@ -416,6 +807,8 @@ void phoneui_show_incoming_cb(GObject *source, GAsyncResult *res, gpointer data)
 	GError *error = NULL;
 	phoneui_call_management_call_display_incoming_finish
 			(PHONEUI_CALL_MANAGEMENT(source), res, &error);
+	if (!error)
+		calls_incoming_displayed(GPOINTER_TO_INT(data));
 	_handle_dbus_error(error, "failed showing incoming call");
 }
 
@@ -491,6 +884,10 @@ void phoneui_show_idle_cb(GObject *source, GAsyncResult *res, gpointer data)
 	GError *error = NULL;
 	phoneui_idle_screen_call_display_finish
 			(PHONEUI_IDLE_SCREEN(source), res, &error);
+	if (error)
+		phoneui_visible.idle_screen = PHONEUI_UNKNOWN;
+	else
+		phoneui_visible.idle_screen = PHONEUI_SHOWN;
 	_handle_dbus_error(error, "failed displaying idle screen");
 }
 
@@ -499,6 +896,10 @@ void phoneui_hide_idle_cb(GObject *source, GAsyncResult *res, gpointer data)
 	GError *error = NULL;
 	phoneui_idle_screen_call_hide_finish
 			(PHONEUI_IDLE_SCREEN(source), res, &error);
+	if (error)
+		phoneui_visible.idle_screen = PHONEUI_UNKNOWN;
+	else
+		phoneui_visible.idle_screen = PHONEUI_HIDDEN;
 	_handle_dbus_error(error, "failed hiding idle screen");
 }
 
@@ -507,6 +908,8 @@ void phoneui_toggle_idle_cb(GObject *source, GAsyncResult *res, gpointer data)
 	GError *error = NULL;
 	phoneui_idle_screen_call_toggle_finish
 			(PHONEUI_IDLE_SCREEN(source), res, &error);
+	if (error)
+		phoneui_visible.idle_screen = PHONEUI_UNKNOWN;
 	_handle_dbus_error(error, "failed toggling idle screen");
 }
 
@@ -523,6 +926,10 @@ void phoneui_activate_screensaver_cb(GObject *source, GAsyncResult *res, gpointe
 	GError *error = NULL;
 	phoneui_idle_screen_call_activate_screensaver_finish
 			(PHONEUI_IDLE_SCREEN(source), res, &error);
+	if (error)
+		phoneui_visible.screensaver = PHONEUI_UNKNOWN;
+	else
+		phoneui_visible.screensaver = PHONEUI_SHOWN;
 	_handle_dbus_error(error, "failed activating screensaver");
 }
 
@@ -531,6 +938,10 @@ void phoneui_deactivate_screensaver_cb(GObject *source, GAsyncResult *res, gpoin
 	GError *error = NULL;
 	phoneui_idle_screen_call_deactivate_screensaver_finish
 			(PHONEUI_IDLE_SCREEN(source), res, &error);
+	if (error)
+		phoneui_visible.screensaver = PHONEUI_UNKNOWN;
+	else
+		phoneui_visible.screensaver = PHONEUI_HIDDEN;
 	_handle_dbus_error(error, "failed deactivating screensaver");
 }
 
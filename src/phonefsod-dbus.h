@@ -22,6 +22,16 @@
 int phonefsod_dbus_setup();
 void phonefsod_dbus_shutdown();
 
+/* emits PropertiesChanged for the settings that changed */
+void phonefsod_settings_changed();
+
+/* phoneuid - only issued when they change what is shown */
+void phonefsod_idle_screen_show();
+void phonefsod_idle_screen_toggle();
+void phonefsod_idle_screen_invalidate();
+void phonefsod_screensaver_set(gboolean active);
+guint phonefsod_phoneui_calls_skipped();
+
 /* phoneuid - dbus callbacks */
 void phoneui_show_incoming_cb(GObject *source, GAsyncResult *res, gpointer data);
 void phoneui_hide_incoming_cb(GObject *source, GAsyncResult *res, gpointer data);
@@ -17,7 +17,6 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <glib.h>
 #include <gio/gio.h>
 #include <freesmartphone.h>
@@ -26,8 +25,29 @@
 #include "phonefsod-fso.h"
 #include "phonefsod-globals.h"
 #include "phonefsod-dbus-common.h"
+#include "phonefsod-ready.h"
+#include "phonefsod-timeline.h"
+#include "phonefsod-retry.h"
+#include "phonefsod-calls.h"
+#include "phonefsod-contacts.h"
+#include "phonefsod-histogram.h"
+#include "phonefsod-wake.h"
+#include "phonefsod-recorder.h"
+#include "phonefsod-config.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_FSO
+#include "phonefsod-log.h"
 
 #define MIN_SIM_SLOTS_FREE 1
+/* re-validate the estimated free slots against the SIM when
+ * they get this low... and anyway every so many seconds */
+#define SIM_SLOTS_LOW_WATERMARK (MIN_SIM_SLOTS_FREE + 2)
+#define SIM_SLOTS_REVALIDATE_INTERVAL 3600
+/* maximum delay between two attempts to re-register */
+#define MAX_REREGISTER_DELAY 1800
+
+/* brightness changes closer together than this are
+ * merged into a single write of the final level */
+#define BRIGHTNESS_COALESCE_MS 300
 
 struct _fso {
 	FreeSmartphoneUsage *usage;
@@ -52,10 +72,6 @@ enum PhoneUiDialogType {
 	PHONEUI_DIALOG_SIM_NOT_PRESENT
 };
 
-typedef struct {
-	int id;
-} call_t;
-
 
 static gboolean show_sim_not_present = TRUE;
 static gboolean sim_ready = FALSE;
@@ -63,20 +79,93 @@ static gboolean gsm_request_running = FALSE;
 static gboolean gsm_available = FALSE;
 static gboolean func_is_set = FALSE;
 static gboolean sim_check_needed = TRUE;
-static time_t startup_time = 0;
-static call_t *incoming_calls = NULL;
-static call_t *outgoing_calls = NULL;
-static int incoming_calls_size = 0;
-static int outgoing_calls_size = 0;
+static gboolean sim_info_running = FALSE;
+static int sim_slots_total = -1;
+static int sim_slots_used = -1;
+static guint sim_slots_revalidate_id = 0;
+static struct {
+	gboolean active;	/* suspend inhibited as we are starting up */
+	gint64 deadline;	/* monotonic us */
+	guint timeout_id;
+} startup = { FALSE, 0, 0 };
 static gboolean display_state = FALSE;
+static FreeSmartphoneDeviceIdleState idle_state =
+	FREE_SMARTPHONE_DEVICE_IDLE_STATE_BUSY;
+static FreeSmartphoneDevicePowerStatus power_status =
+	FREE_SMARTPHONE_DEVICE_POWER_STATUS_UNKNOWN;
+static gboolean fso_connected = FALSE;
+static gboolean gsm_connected = FALSE;
+static gboolean usage_running = FALSE;
+static gboolean gsm_running = FALSE;
+static gboolean device_running = FALSE;
+static guint usage_watcher_id = 0;
+static guint gsm_watcher_id = 0;
+static guint device_watcher_id = 0;
 
 
 static gboolean _fso_list_resources();
 static gboolean _fso_request_gsm();
 static void _fso_suspend();
 static void _stop_startup();
-static void _startup_check();
+static void _sim_slots_revalidate_start();
+static void _sim_slots_revalidate_stop();
+static gboolean _startup_timeout(gpointer data);
 static gint _fso_sim_info();
+static void _usage_service_up();
+static void _gsm_service_up();
+static void _device_service_up();
+
+/* retried operations */
+static retry_t gsm_request_retry =
+	RETRY_INIT("RequestResource(GSM)", 1, 300, _fso_request_gsm);
+static retry_t sim_info_retry =
+	RETRY_INIT("GetSimInfo", 3, 600, (GSourceFunc) _fso_sim_info);
+
+/* network re-registration watchdog */
+static gboolean _fso_network_register();
+static void _reregister_update(const char *registration);
+static void _reregister_stop();
+static void _network_register_callback(GObject *source, GAsyncResult *res, gpointer data);
+
+static retry_t reregister_retry =
+	RETRY_INIT("Register", 60, MAX_REREGISTER_DELAY, _fso_network_register);
+
+static struct {
+	gint64 lost_since;	/* monotonic us, 0 while registered */
+	guint timeout_id;
+	guint outages;
+	guint recoveries;
+	guint attempts;		/* of the current outage */
+	guint total_attempts;
+	gint64 last_recovery;	/* us */
+	gint64 max_recovery;	/* us */
+} reregister;
+
+/* suspend governor... eligibility is recalculated whenever one of
+ * its inputs changes so the SUSPEND idle state is handled at once */
+static void _suspend_update();
+
+static struct {
+	gboolean eligible;
+	const char *blocker;	/* why we may not suspend */
+	gint64 requested;	/* monotonic us of the SUSPEND idle state */
+	histogram_t latency;
+} suspend_governor = {
+	FALSE, "not started", 0, HISTOGRAM_INIT("suspend-latency")
+};
+
+/* brightness controller */
+static gboolean _brightness_flush(gpointer data);
+
+static struct {
+	int applied;		/* last level written, -1 if unknown */
+	int pending;		/* level waiting for the window to close */
+	gint64 last_write;	/* monotonic us */
+	guint timeout_id;
+	guint issued;
+	guint unchanged;	/* dropped as the level was already set */
+	guint coalesced;	/* replaced by a later level in the window */
+} brightness = { -1, -1, 0, 0, 0, 0, 0 };
 
 
 /* dbus method callbacks */
@@ -87,8 +176,13 @@ static void _going_online_callback(GObject *source, GAsyncResult *res, gpointer
 static void _gsm_sim_ready_status_callback(GObject *source, GAsyncResult *res, gpointer data);
 static void _gsm_sim_sim_info_callback(GObject *source, GAsyncResult *res, gpointer data);
 static void _set_functionality_callback(GObject *source, GAsyncResult *res, gpointer data);
-static void _get_power_status_callback(GObject *source, GAsyncResult *res, gpointer data);
+static void _power_status_callback(GObject *source, GAsyncResult *res, gpointer data);
 static void _get_idle_state_callback(GObject *source, GAsyncResult *res, gpointer data);
+static void _gsm_device_status_callback(GObject *source, GAsyncResult *res, gpointer data);
+
+/* g_bus_watch_name callbacks */
+static void _on_fso_service_appeared(GDBusConnection *connection, const gchar *name, const gchar *name_owner, gpointer user_data);
+static void _on_fso_service_vanished(GDBusConnection *connection, const gchar *name, gpointer user_data);
 
 /* dbus signal handlers */
 static void _usage_resource_available_handler(GSource *source, char *resource, gboolean availability, gpointer data);
@@ -98,245 +192,499 @@ static void _gsm_sim_ready_status_handler(GSource *source, gboolean status, gpoi
 static void _gsm_device_status_handler(GSource *source, FreeSmartphoneGSMDeviceStatus status, gpointer data);
 static void _device_idle_notifier_state_handler(GSource *source, FreeSmartphoneDeviceIdleState state, gpointer data);
 static void _device_input_event_handler(GSource *source, char *src, FreeSmartphoneDeviceInputState state, int duration, gpointer data);
+static void _device_power_status_handler(GSource *source, FreeSmartphoneDevicePowerStatus status, gpointer data);
 static void _gsm_call_status_handler(GSource *source, int call_id, int status, GHashTable *properties, gpointer data);
 static void _pim_incoming_message_handler(GSource *source, char *message_path, gpointer data);
 static void _gsm_network_incoming_ussd_handler(GSource *source, int mode, char *message, gpointer data);
 static void _gsm_network_status_handler(GSource *source, GHashTable *status, gpointer data);
 
-/* call management */
-static void _call_add(call_t ** calls, int *size, int id);
-static int _call_check(call_t * calls, int *size, int id);
-static void _call_remove(call_t ** calls, int *size, int id);
 
+struct _proxy_request {
+	gpointer *proxy;
+	const gchar *name;
+	const gchar *path;
+	void (*connected)(gpointer proxy);
+};
+
+/* completion barrier for the asynchronous bring-up of all FSO proxies */
+static struct {
+	int pending;
+	int total;
+	int failures;
+	GString *failed;
+} bringup;
+
+static void
+_bringup_release()
+{
+	/* proxies connected after startup (eg. GSM when leaving
+	 * offline mode) do not take part in the bring-up */
+	if (--bringup.pending > 0 || fso_connected)
+		return;
+
+	if (bringup.failures) {
+		g_warning("Connected to FSO with %d of %d proxies failing: %s",
+			  bringup.failures, bringup.total, bringup.failed->str);
+	}
+	else {
+		g_message("Connected to all %d FSO proxies", bringup.total);
+	}
+	g_string_free(bringup.failed, TRUE);
+	bringup.failed = NULL;
+	timeline_mark(MILESTONE_FSO_CONNECTED);
+	phonefsod_ready_set(READY_FSO);
+
+	fso_startup();
+}
 
-static gpointer
-_dbus_proxy(GType type, const gchar *obj, const gchar *path, const gchar *iface)
+static void
+_dbus_proxy_ready(GObject *source, GAsyncResult *res, gpointer data)
 {
+	struct _proxy_request *req = data;
 	GError *error = NULL;
-	gpointer ret;
+	GObject *proxy;
 
-	ret = g_initable_new(type, NULL, &error,
-				"g-flags", G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+	proxy = g_async_initable_new_finish(G_ASYNC_INITABLE(source), res, &error);
+	if (error) {
+		g_warning("failed to connect to %s: %s", req->path, error->message);
+		g_error_free(error);
+		if (bringup.failed) {
+			if (bringup.failures++)
+				g_string_append(bringup.failed, ", ");
+			g_string_append(bringup.failed, req->name);
+		}
+	}
+	else {
+		*req->proxy = proxy;
+		if (req->connected)
+			req->connected(proxy);
+		log_debug("Connected to %s", req->name);
+	}
+
+	g_free(req);
+	_bringup_release();
+}
+
+/* starts the construction of a proxy without blocking, the
+ * barrier is released when it is done - successful or not */
+static void
+_dbus_proxy_async(GType type, const gchar *obj, const gchar *path,
+		  const gchar *iface, GDBusProxyFlags flags, gpointer *proxy,
+		  const gchar *name, void (*connected)(gpointer proxy))
+{
+	struct _proxy_request *req;
+
+	req = g_new0(struct _proxy_request, 1);
+	req->proxy = proxy;
+	req->name = name;
+	req->path = path;
+	req->connected = connected;
+
+	bringup.pending++;
+	bringup.total++;
+	g_async_initable_new_async(type, G_PRIORITY_DEFAULT, NULL,
+				_dbus_proxy_ready, req,
+				"g-flags", G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES | flags,
 				"g-name", obj,
 				"g-bus-type", G_BUS_TYPE_SYSTEM,
 				"g-object-path", path,
 				"g-interface-name", iface,
 				NULL);
-
-	if (error) {
-		g_warning("failed to connect to %s: %s", path, error->message);
-		g_error_free(error);
-		return NULL;
-	}
-
-	return ret;
 }
 
 gboolean
 fso_init()
 {
 	sim_auth_needed = FALSE;
-	if (!offline_mode) {
+	fso_reregister_timeout_update();
+	/* 0 means no startup phase at all */
+	if (!offline_mode && inhibit_suspend_on_startup_time > 0) {
 		g_message("Inhibiting suspend during startup phase (max %ds)",
 			  inhibit_suspend_on_startup_time);
-		startup_time = time(NULL);
-	}
+		startup.active = TRUE;
+		startup.deadline = g_get_monotonic_time() +
+			(gint64) inhibit_suspend_on_startup_time * G_USEC_PER_SEC;
+		startup.timeout_id = g_timeout_add_seconds
+			(inhibit_suspend_on_startup_time, _startup_timeout, NULL);
+	}
+	_suspend_update();
+
+	/* all proxies are created in parallel... hold the barrier
+	 * until every one of them is launched */
+	bringup.pending = 1;
+	bringup.total = 0;
+	bringup.failures = 0;
+	bringup.failed = g_string_new(NULL);
+
+	/* startup is driven by the FSO services appearing on the bus */
+	usage_watcher_id = g_bus_watch_name_on_connection
+		(system_bus, FSO_USAGE_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE,
+		 _on_fso_service_appeared, _on_fso_service_vanished, NULL, NULL);
+	gsm_watcher_id = g_bus_watch_name_on_connection
+		(system_bus, FSO_GSM_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE,
+		 _on_fso_service_appeared, _on_fso_service_vanished, NULL, NULL);
+	device_watcher_id = g_bus_watch_name_on_connection
+		(system_bus, FSO_DEVICE_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE,
+		 _on_fso_service_appeared, _on_fso_service_vanished, NULL, NULL);
 
 	fso_connect_usage();
-	fso_connect_gsm();
-	fso_connect_pim();
 	fso_connect_device();
+	/* an offline device never needs the GSM bits... they
+	 * are connected when leaving offline mode */
+	if (!offline_mode) {
+		fso_connect_gsm();
+		fso_connect_pim();
+	}
 
-	/* send fsogsmd a ping to dbus-activate it, if not running yet */
-/*	if (fso.gsm_device)
-		free_smartphone_gsm_device_get_device_status(fso.gsm_device, NULL, NULL);*/
-	g_debug("Done connecting to FSO");
+	log_debug("Launched connecting to FSO");
+	_bringup_release();
 
 	return TRUE;
 }
 
+void
+fso_shutdown()
+{
+	g_bus_unwatch_name(usage_watcher_id);
+	g_bus_unwatch_name(gsm_watcher_id);
+	g_bus_unwatch_name(device_watcher_id);
+	contacts_shutdown();
+}
+
+static void
+_usage_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "resource-changed",
+			G_CALLBACK(_usage_resource_changed_handler), NULL);
+	g_signal_connect(G_OBJECT(proxy), "resource-available",
+			G_CALLBACK(_usage_resource_available_handler), NULL);
+	g_signal_connect(G_OBJECT(proxy), "system-action",
+			 G_CALLBACK(_usage_system_action_handler), NULL);
+}
+
 void
 fso_connect_usage()
 {
-	g_debug("connecting to %s", FSO_USAGE_SERVICE);
+	log_debug("connecting to %s", FSO_USAGE_SERVICE);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_TYPE_USAGE_PROXY,
+			  FSO_USAGE_SERVICE,
+			  FSO_USAGE_PATH,
+			  FSO_USAGE_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.usage, "FSO/Usage",
+			  _usage_connected);
+}
 
-	fso.usage = (FreeSmartphoneUsage *)
-			(_dbus_proxy
-				(FREE_SMARTPHONE_TYPE_USAGE_PROXY,
-				 FSO_USAGE_SERVICE,
-				 FSO_USAGE_PATH,
-				 FSO_USAGE_IFACE)
-			);
+static void
+_gsm_device_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "device-status",
+			 G_CALLBACK(_gsm_device_status_handler), NULL);
+	/* connected late when leaving offline mode... ogsmd
+	 * will not appear again so catch up with it here */
+	if (fso_connected && gsm_running)
+		_gsm_service_up();
+}
 
-	if (fso.usage) {
-		g_signal_connect(G_OBJECT(fso.usage), "resource-changed",
-				G_CALLBACK(_usage_resource_changed_handler), NULL);
-		g_signal_connect(G_OBJECT(fso.usage), "resource-available",
-				G_CALLBACK(_usage_resource_available_handler), NULL);
-		g_signal_connect(G_OBJECT(fso.usage), "system-action",
-				 G_CALLBACK(_usage_system_action_handler), NULL);
-		g_debug("Connected to FSO/Usage");
-	}
+static void
+_gsm_network_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "status",
+			G_CALLBACK(_gsm_network_status_handler), NULL);
+	g_signal_connect(G_OBJECT(proxy), "incoming-ussd",
+			G_CALLBACK(_gsm_network_incoming_ussd_handler), NULL);
+}
+
+static void
+_gsm_call_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "call-status",
+			G_CALLBACK(_gsm_call_status_handler), NULL);
 }
 
 void
 fso_connect_gsm()
 {
-	g_debug("connecting to %s", FSO_GSM_SERVICE);
-
-	fso.gsm_device = (FreeSmartphoneGSMDevice *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_GSM_TYPE_DEVICE_PROXY,
-					 FSO_GSM_SERVICE,
-					 FSO_GSM_DEVICE_PATH,
-					 FSO_GSM_DEVICE_IFACE)
-				);
-
-	if (fso.gsm_device) {
-		g_debug("Connected to FSO/GSM/Device");
-		g_signal_connect(G_OBJECT(fso.gsm_device), "device-status",
-				 G_CALLBACK(_gsm_device_status_handler), NULL);
-	}
-
-	fso.gsm_sim = (FreeSmartphoneGSMSIM *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_GSM_TYPE_SIM_PROXY,
-					 FSO_GSM_SERVICE,
-					 FSO_GSM_DEVICE_PATH,
-					 FSO_GSM_SIM_IFACE)
-				);
-
-	fso.gsm_network = (FreeSmartphoneGSMNetwork *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_GSM_TYPE_NETWORK_PROXY,
-					 FSO_GSM_SERVICE,
-					 FSO_GSM_DEVICE_PATH,
-					 FSO_GSM_NETWORK_IFACE)
-				);
-	if (fso.gsm_network) {
-		g_signal_connect(G_OBJECT(fso.gsm_network), "status",
-				G_CALLBACK(_gsm_network_status_handler), NULL);
-		g_signal_connect(G_OBJECT(fso.gsm_network), "incoming-ussd",
-				G_CALLBACK(_gsm_network_incoming_ussd_handler), NULL);
-		g_debug("Connected to FSO/GSM/Network");
-	}
-
-	fso.gsm_pdp = (FreeSmartphoneGSMPDP *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_GSM_TYPE_PDP_PROXY,
-					 FSO_GSM_SERVICE,
-					 FSO_GSM_DEVICE_PATH,
-					 FSO_GSM_PDP_IFACE)
-				);
-
-	fso.gsm_call = (FreeSmartphoneGSMCall *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_GSM_TYPE_CALL_PROXY,
-					 FSO_GSM_SERVICE,
-					 FSO_GSM_DEVICE_PATH,
-					 FSO_GSM_CALL_IFACE)
-				);
-	if (fso.gsm_call) {
-		g_signal_connect(G_OBJECT(fso.gsm_call), "call-status",
-				G_CALLBACK(_gsm_call_status_handler), NULL);
-		g_debug("Connected to FSO/GSM/Call");
-	}
+	if (gsm_connected)
+		return;
+	gsm_connected = TRUE;
+
+	log_debug("connecting to %s", FSO_GSM_SERVICE);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_GSM_TYPE_DEVICE_PROXY,
+			  FSO_GSM_SERVICE,
+			  FSO_GSM_DEVICE_PATH,
+			  FSO_GSM_DEVICE_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.gsm_device, "FSO/GSM/Device",
+			  _gsm_device_connected);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_GSM_TYPE_NETWORK_PROXY,
+			  FSO_GSM_SERVICE,
+			  FSO_GSM_DEVICE_PATH,
+			  FSO_GSM_NETWORK_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.gsm_network, "FSO/GSM/Network",
+			  _gsm_network_connected);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_GSM_TYPE_CALL_PROXY,
+			  FSO_GSM_SERVICE,
+			  FSO_GSM_DEVICE_PATH,
+			  FSO_GSM_CALL_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.gsm_call, "FSO/GSM/Call",
+			  _gsm_call_connected);
+}
 
+static void
+_pim_messages_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "incoming-message",
+			G_CALLBACK(_pim_incoming_message_handler), NULL);
 }
 
 void
 fso_connect_pim()
 {
-	g_debug("connecting to %s", FSO_PIM_SERVICE);
+	log_debug("connecting to %s", FSO_PIM_SERVICE);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_PIM_TYPE_MESSAGES_PROXY,
+			  FSO_PIM_SERVICE,
+			  FSO_PIM_MESSAGES_PATH,
+			  FSO_PIM_MESSAGES_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.pim_messages, "FSO/PIM/Messages",
+			  _pim_messages_connected);
+	contacts_init();
+}
 
-	fso.pim_messages = (FreeSmartphonePIMMessages *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_PIM_TYPE_MESSAGES_PROXY,
-					 FSO_PIM_SERVICE,
-					 FSO_PIM_MESSAGES_PATH,
-					 FSO_PIM_MESSAGES_IFACE)
-				);
-	if (fso.pim_messages) {
-		g_signal_connect(G_OBJECT(fso.pim_messages), "incoming-message",
-				G_CALLBACK(_pim_incoming_message_handler), NULL);
-		g_debug("Connected to FSO/PIM/Messages");
-	}
+static void
+_idle_notifier_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "state",
+		G_CALLBACK(_device_idle_notifier_state_handler), NULL);
+}
+
+static void
+_input_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "event",
+			 G_CALLBACK(_device_input_event_handler), NULL);
+}
+
+static void
+_power_supply_connected(gpointer proxy)
+{
+	g_signal_connect(G_OBJECT(proxy), "power-status",
+			 G_CALLBACK(_device_power_status_handler), NULL);
 }
 
 void
 fso_connect_device()
 {
-	g_debug("connecting to %s", FSO_DEVICE_SERVICE);
-
-	fso.idle_notifier = (FreeSmartphoneDeviceIdleNotifier *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_DEVICE_TYPE_IDLE_NOTIFIER_PROXY,
-					 FSO_DEVICE_SERVICE,
-					 FSO_DEVICE_IDLE_NOTIFIER_PATH,
-					 FSO_DEVICE_IDLE_NOTIFIER_IFACE)
-				);
-	if (fso.idle_notifier) {
-		g_signal_connect(G_OBJECT(fso.idle_notifier), "state",
-			G_CALLBACK(_device_idle_notifier_state_handler), NULL);
-		g_debug("Connected to FSO/Device/IdleNotifier");
-	}
-
-	fso.input = (FreeSmartphoneDeviceInput *)
-			(_dbus_proxy
-				(FREE_SMARTPHONE_DEVICE_TYPE_INPUT_PROXY,
-				 FSO_DEVICE_SERVICE,
-				 FSO_DEVICE_INPUT_PATH,
-				 FSO_DEVICE_INPUT_IFACE)
-			);
-	if (fso.input) {
-		g_signal_connect(G_OBJECT(fso.input), "event",
-				 G_CALLBACK(_device_input_event_handler), NULL);
-		g_debug("Connected to FSO/Device/Input");
-	}
-
-	fso.display = (FreeSmartphoneDeviceDisplay *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_DEVICE_TYPE_DISPLAY_PROXY,
-					 FSO_DEVICE_SERVICE,
-					 FSO_DEVICE_DISPLAY_PATH,
-					 FSO_DEVICE_DISPLAY_IFACE)
-				);
-	if (fso.display) {
-		g_debug("Connected to FSO/Device/Display");
-	}
-
-	fso.power_supply = (FreeSmartphoneDevicePowerSupply *)
-				(_dbus_proxy
-					(FREE_SMARTPHONE_DEVICE_TYPE_POWER_SUPPLY_PROXY,
-					 FSO_DEVICE_SERVICE,
-					 FSO_DEVICE_POWER_SUPPLY_PATH,
-					 FSO_DEVICE_POWER_SUPPLY_IFACE)
-				);
-	if (fso.power_supply) {
-		g_debug("Connected to FSO/Device/PowerSupply");
-	}
+	log_debug("connecting to %s", FSO_DEVICE_SERVICE);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_DEVICE_TYPE_IDLE_NOTIFIER_PROXY,
+			  FSO_DEVICE_SERVICE,
+			  FSO_DEVICE_IDLE_NOTIFIER_PATH,
+			  FSO_DEVICE_IDLE_NOTIFIER_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.idle_notifier, "FSO/Device/IdleNotifier",
+			  _idle_notifier_connected);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_DEVICE_TYPE_INPUT_PROXY,
+			  FSO_DEVICE_SERVICE,
+			  FSO_DEVICE_INPUT_PATH,
+			  FSO_DEVICE_INPUT_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.input, "FSO/Device/Input",
+			  _input_connected);
+
+	_dbus_proxy_async(FREE_SMARTPHONE_DEVICE_TYPE_DISPLAY_PROXY,
+			  FSO_DEVICE_SERVICE,
+			  FSO_DEVICE_DISPLAY_PATH,
+			  FSO_DEVICE_DISPLAY_IFACE,
+			  G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+			  (gpointer *)&fso.display, "FSO/Device/Display",
+			  NULL);
+
+	/* the power status is followed via its signal so dimming
+	 * and suspending never have to ask for it */
+	_dbus_proxy_async(FREE_SMARTPHONE_DEVICE_TYPE_POWER_SUPPLY_PROXY,
+			  FSO_DEVICE_SERVICE,
+			  FSO_DEVICE_POWER_SUPPLY_PATH,
+			  FSO_DEVICE_POWER_SUPPLY_IFACE,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  (gpointer *)&fso.power_supply, "FSO/Device/PowerSupply",
+			  _power_supply_connected);
 }
 
-gboolean
-fso_startup()
+static void
+_usage_service_up()
 {
-	g_debug("FSO starting up");
-
 	/* we only have to list the resources when we did
 	 * not yet handle it due to a resource available
 	 * signal for the GSM resource */
 	if (!gsm_request_running && !gsm_available) {
 		_fso_list_resources();
 	}
+}
+
+static void
+_gsm_service_up()
+{
+	if (!fso.gsm_device)
+		return;
 
+	_sim_slots_revalidate_start();
+	/* fetch the current device status in case ogsmd
+	 * was already running before we got here */
+	free_smartphone_gsm_device_get_device_status
+			(fso.gsm_device, _gsm_device_status_callback, NULL);
+}
+
+static void
+_device_service_up()
+{
+	/* the display might have been touched while odeviced
+	 * was away... do not trust the last level written */
+	brightness.applied = -1;
+
+	/* fetch the status once... from then on the
+	 * power-status signal keeps it up to date */
+	if (fso.power_supply) {
+		free_smartphone_device_power_supply_get_power_status
+			(fso.power_supply, _power_status_callback, NULL);
+	}
 	fso_dimit(100, DIM_SCREEN_ALWAYS);
+}
+
+/* the proxies below are only needed now and then and do not
+ * deliver signals we are interested in... they are created on
+ * first use, without blocking and without installing any match
+ * rules. The call waiting for one is made once it is there */
+struct _lazy_proxy {
+	gpointer *proxy;
+	const gchar *iface;
+	gboolean connecting;
+	void (*ready)(gboolean connected);
+};
+
+static void _fso_sim_info_send(gboolean connected);
+static void _fso_pdp_set_credentials_send(gboolean connected);
+
+static struct _lazy_proxy lazy_gsm_sim = {
+	(gpointer *) &fso.gsm_sim, FSO_GSM_SIM_IFACE,
+	FALSE, _fso_sim_info_send
+};
+static struct _lazy_proxy lazy_gsm_pdp = {
+	(gpointer *) &fso.gsm_pdp, FSO_GSM_PDP_IFACE,
+	FALSE, _fso_pdp_set_credentials_send
+};
+
+static void
+_lazy_proxy_ready(GObject *source, GAsyncResult *res, gpointer data)
+{
+	struct _lazy_proxy *lazy = (struct _lazy_proxy *) data;
+	GError *error = NULL;
+	GObject *proxy;
+
+	lazy->connecting = FALSE;
+	proxy = g_async_initable_new_finish(G_ASYNC_INITABLE(source), res, &error);
+	if (error) {
+		g_warning("failed to connect to %s: %s",
+			  lazy->iface, error->message);
+		g_error_free(error);
+		lazy->ready(FALSE);
+		return;
+	}
+
+	*lazy->proxy = proxy;
+	lazy->ready(TRUE);
+}
+
+static void
+_lazy_proxy_call(struct _lazy_proxy *lazy, GType type)
+{
+	if (*lazy->proxy) {
+		lazy->ready(TRUE);
+		return;
+	}
+	/* the call is made when the proxy being created is ready */
+	if (lazy->connecting)
+		return;
+
+	lazy->connecting = TRUE;
+	g_async_initable_new_async(type, G_PRIORITY_DEFAULT, NULL,
+			_lazy_proxy_ready, lazy,
+			"g-flags", G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+				G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+			"g-name", FSO_GSM_SERVICE,
+			"g-bus-type", G_BUS_TYPE_SYSTEM,
+			"g-object-path", FSO_GSM_DEVICE_PATH,
+			"g-interface-name", lazy->iface,
+			NULL);
+}
+
+/* an unknown status counts as running on battery */
+static gboolean
+_on_external_power()
+{
+	return power_status == FREE_SMARTPHONE_DEVICE_POWER_STATUS_AC ||
+		power_status == FREE_SMARTPHONE_DEVICE_POWER_STATUS_CHARGING;
+}
+
+gboolean
+fso_startup()
+{
+	log_debug("FSO starting up");
+	fso_connected = TRUE;
+
+	/* kick everything that is already on the bus... the rest
+	 * is handled when the services appear */
+	if (usage_running)
+		_usage_service_up();
+	if (gsm_running)
+		_gsm_service_up();
+	if (device_running)
+		_device_service_up();
+
+	return FALSE;
+}
+
+static void
+_brightness_apply(int b)
+{
+	log_debug("setting brightness to %d", b);
+	recorder_add(REC_BRIGHTNESS, b, 0);
+	brightness.issued++;
+	brightness.applied = b;
+	brightness.last_write = g_get_monotonic_time();
 
+	free_smartphone_device_display_set_brightness
+			(fso.display, b, NULL, NULL);
+
+	phonefsod_screensaver_set(b == 0);
+}
+
+static gboolean
+_brightness_flush(gpointer data)
+{
+	(void) data;
+	brightness.timeout_id = 0;
+	if (brightness.pending == brightness.applied)
+		brightness.unchanged++;
+	else
+		_brightness_apply(brightness.pending);
+	brightness.pending = -1;
 	return FALSE;
 }
 
 static void
 _fso_dim_screen(int percent)
 {
+	gint64 since;
 	int b = default_brightness * percent / 100;
 	if (b > 100) {
 		b = 100;
@@ -345,39 +693,27 @@ _fso_dim_screen(int percent)
 		b = 0;
 	}
 
-	free_smartphone_device_display_set_brightness
-			(fso.display, b, NULL, NULL);
-
-	if (b == 0) {
-		phoneui_idle_screen_call_activate_screensaver
-			(phoneui.idle_screen, NULL,
-			 phoneui_activate_screensaver_cb, NULL);
+	/* a write is already scheduled... just update its level */
+	if (brightness.timeout_id) {
+		brightness.coalesced++;
+		brightness.pending = b;
+		return;
 	}
-	else {
-		phoneui_idle_screen_call_deactivate_screensaver
-			(phoneui.idle_screen, NULL,
-			 phoneui_deactivate_screensaver_cb, NULL);
+	if (b == brightness.applied) {
+		brightness.unchanged++;
+		return;
 	}
-}
 
-static void
-_get_power_status_for_dimming_callback(GObject *source,
-					    GAsyncResult *res,
-					    gpointer data)
-{
-	(void) source;
-	GError *error = NULL;
-	FreeSmartphoneDevicePowerStatus status;
-
-	status = free_smartphone_device_power_supply_get_power_status_finish
-						(fso.power_supply, res, &error);
-	g_debug("PowerStatus is %d", status);
-	if (error == NULL && (status == FREE_SMARTPHONE_DEVICE_POWER_STATUS_AC ||
-		status == FREE_SMARTPHONE_DEVICE_POWER_STATUS_CHARGING)) {
-		g_debug("not suspending due to charging or battery full");
+	/* the first change is written right away, more
+	 * changes following shortly after are merged */
+	since = (g_get_monotonic_time() - brightness.last_write) / 1000;
+	if (brightness.last_write && since < BRIGHTNESS_COALESCE_MS) {
+		brightness.pending = b;
+		brightness.timeout_id = g_timeout_add
+			(BRIGHTNESS_COALESCE_MS - since, _brightness_flush, NULL);
 		return;
 	}
-	_fso_dim_screen(GPOINTER_TO_INT(data));
+	_brightness_apply(b);
 }
 
 void
@@ -389,11 +725,8 @@ fso_dimit(int percent, int dim)
 
 	/* for dimming only on bat we have to check
 	 * if power is plugged in */
-	if (dim == DIM_SCREEN_ONBAT) {
-		free_smartphone_device_power_supply_get_power_status
-			(fso.power_supply,
-			_get_power_status_for_dimming_callback,
-			 GINT_TO_POINTER(percent));
+	if (dim == DIM_SCREEN_ONBAT && _on_external_power()) {
+		log_debug("not dimming due to charging or battery full");
 		return;
 	}
 	_fso_dim_screen(percent);
@@ -404,11 +737,27 @@ fso_set_functionality()
 {
 	if (offline_mode) {
 		_stop_startup();
+		_reregister_stop();
+		_sim_slots_revalidate_stop();
+		/* nothing to do if GSM was never brought up */
+		if (!fso.gsm_device)
+			return FALSE;
+		recorder_add(REC_REQUEST, REC_REQUEST_SET_FUNCTIONALITY, FALSE);
 		free_smartphone_gsm_device_set_functionality
 			(fso.gsm_device, "airplane", FALSE, sim_pin ? sim_pin : "",
 			_set_functionality_callback, NULL);
 	}
+	else if (!gsm_connected) {
+		/* we were offline since startup... bring up GSM now,
+		 * the functionality is set as soon as the SIM is ready */
+		g_message("Leaving offline mode - connecting GSM");
+		fso_connect_gsm();
+		fso_connect_pim();
+		_fso_request_gsm();
+	}
 	else {
+		_sim_slots_revalidate_start();
+		recorder_add(REC_REQUEST, REC_REQUEST_SET_FUNCTIONALITY, TRUE);
 		free_smartphone_gsm_device_set_functionality
 			(fso.gsm_device, "full", TRUE, sim_pin ? sim_pin : "",
 			_set_functionality_callback, NULL);
@@ -419,16 +768,64 @@ fso_set_functionality()
 void
 fso_pdp_set_credentials()
 {
-	if (!pdp_apn || !pdp_user || !pdp_password)
+	if (!pdp_apn || !pdp_user || !pdp_password || !gsm_connected)
+		return;
+
+	_lazy_proxy_call(&lazy_gsm_pdp, FREE_SMARTPHONE_GSM_TYPE_PDP_PROXY);
+}
+
+static void
+_fso_pdp_set_credentials_send(gboolean connected)
+{
+	/* the credentials might have gone while connecting */
+	if (!connected || !pdp_apn || !pdp_user || !pdp_password)
 		return;
 
 	free_smartphone_gsm_pdp_set_credentials
 		(fso.gsm_pdp, pdp_apn, pdp_user, pdp_password, NULL, NULL);
 }
 
+void
+fso_set_calling_identification()
+{
+	if (!fso.gsm_network)
+		return;
+
+	free_smartphone_gsm_network_set_calling_identification
+		(fso.gsm_network, calling_identification, NULL, NULL);
+}
+
+/* applies the brightness for the current idle state again... for
+ * when the dimming configuration changed */
+void
+fso_redim()
+{
+	/* while Display resource is requested nothing to do */
+	if (display_state)
+		return;
+
+	switch (idle_state) {
+	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_BUSY:
+		fso_dimit(100, dim_screen);
+		break;
+	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_IDLE:
+		fso_dimit(dim_idle_percent, dim_screen);
+		break;
+	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_IDLE_DIM:
+		fso_dimit(dim_idle_dim_percent, dim_screen);
+		break;
+	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_IDLE_PRELOCK:
+		fso_dimit(dim_idle_prelock_percent, dim_screen);
+		break;
+	default:
+		break;
+	}
+}
+
 static gboolean
 _fso_list_resources()
 {
+	recorder_add(REC_REQUEST, REC_REQUEST_LIST_RESOURCES, 0);
 	free_smartphone_usage_list_resources(fso.usage,
 			_list_resources_callback, NULL);
 	return FALSE;
@@ -441,48 +838,142 @@ _fso_request_gsm()
 		/* do not request GSM twice */
 		g_warning("GSM request still running...");
 	}
+	else if (offline_mode) {
+		log_debug("Not requesting GSM in offline mode");
+	}
 	else if (gsm_available) {
 		/* only request GSM if we know it is available */
-		g_debug("Request GSM resource");
+		log_debug("Request GSM resource");
 		gsm_request_running = TRUE;
+		timeline_mark(MILESTONE_GSM_REQUESTED);
+		recorder_add(REC_REQUEST, REC_REQUEST_GSM, 0);
 		free_smartphone_usage_request_resource(fso.usage, "GSM",
 			_request_resource_callback, NULL);
 	}
 	else {
 		g_warning("Not requesting GSM as it is not available");
 	}
-	_startup_check();
 	return FALSE;
 }
 
 static void
-_fso_suspend(void)
+_suspend_update()
 {
-	if (auto_suspend == SUSPEND_NEVER ||
-			startup_time > 0 ||
-			incoming_calls_size > 0 ||
-			outgoing_calls_size > 0) {
+	const char *blocker = NULL;
+
+	if (auto_suspend == SUSPEND_NEVER)
+		blocker = "auto suspend disabled";
+	else if (startup.active)
+		blocker = "startup phase";
+	else if (calls_total() > 0)
+		blocker = "call in progress";
+	else if (display_state)
+		blocker = "Display resource requested";
+	/* for normal suspend behaviour power must not be plugged in */
+	else if (auto_suspend == SUSPEND_NORMAL && _on_external_power())
+		blocker = "charging or battery full";
+
+	if (blocker == suspend_governor.blocker)
 		return;
-	}
+	suspend_governor.blocker = blocker;
+	suspend_governor.eligible = blocker == NULL;
+	if (blocker)
+		log_debug("suspend inhibited: %s", blocker);
+	else
+		log_debug("suspend allowed");
+}
 
-	/* for normal suspend behaviour we have to check
-	 * if power is plugged in */
-	if (auto_suspend == SUSPEND_NORMAL) {
-		free_smartphone_device_power_supply_get_power_status
-			(fso.power_supply,
-			 _get_power_status_callback, NULL);
+/* for when auto_suspend was changed */
+void
+fso_suspend_update()
+{
+	_suspend_update();
+}
+
+/* for when reregister_timeout was changed... a retry already
+ * pending keeps its delay */
+void
+fso_reregister_timeout_update()
+{
+	reregister_retry.base = gsm_reregister_timeout;
+}
+
+static void
+_fso_suspend(void)
+{
+	gint64 latency = 0;
+
+	if (!suspend_governor.eligible) {
+		log_debug("not suspending: %s", suspend_governor.blocker);
+		recorder_add(REC_SUSPEND, FALSE, 0);
+		suspend_governor.requested = 0;
 		return;
 	}
 
+	if (suspend_governor.requested) {
+		latency = g_get_monotonic_time() - suspend_governor.requested;
+		histogram_add(&suspend_governor.latency, latency);
+		suspend_governor.requested = 0;
+	}
+	recorder_add(REC_SUSPEND, TRUE, latency / 1000);
+	recorder_add(REC_REQUEST, REC_REQUEST_SUSPEND, 0);
+	log_flush();
+	config_flush();
 	free_smartphone_usage_suspend(fso.usage, NULL, NULL);
 }
 
 static gint
 _fso_sim_info()
 {
+	/* one query at a time is enough */
+	if (sim_info_running)
+		return 0;
+	sim_info_running = TRUE;
+	_lazy_proxy_call(&lazy_gsm_sim, FREE_SMARTPHONE_GSM_TYPE_SIM_PROXY);
+	return 0;
+}
+
+static void
+_fso_sim_info_send(gboolean connected)
+{
+	if (!connected) {
+		/* no query is running, let the retry start one */
+		sim_info_running = FALSE;
+		retry_schedule(&sim_info_retry);
+		return;
+	}
+
+	recorder_add(REC_REQUEST, REC_REQUEST_SIM_INFO, 0);
 	free_smartphone_gsm_sim_get_sim_info
 		(fso.gsm_sim, _gsm_sim_sim_info_callback, NULL);
-	return 0;
+}
+
+static gboolean
+_sim_slots_revalidate()
+{
+	log_debug("re-validating free SIM slots");
+	_fso_sim_info();
+	return TRUE;
+}
+
+/* the slot model is only re-validated while there is a SIM to ask...
+ * until it is seeded the first SimInfo starts the timer */
+static void
+_sim_slots_revalidate_start()
+{
+	if (sim_slots_revalidate_id || sim_slots_total < 0 || offline_mode)
+		return;
+	sim_slots_revalidate_id = g_timeout_add_seconds
+		(SIM_SLOTS_REVALIDATE_INTERVAL, _sim_slots_revalidate, NULL);
+}
+
+static void
+_sim_slots_revalidate_stop()
+{
+	if (sim_slots_revalidate_id) {
+		g_source_remove(sim_slots_revalidate_id);
+		sim_slots_revalidate_id = 0;
+	}
 }
 
 
@@ -497,26 +988,29 @@ _list_resources_callback(GObject *source, GAsyncResult *res, gpointer data)
 	/* if we successfully got a list of resources...
 	 * check if GSM is within them and request it if
 	 * so, otherwise wait for ResourceAvailable signal */
-	g_debug("list_resources_callback()");
+	log_debug("list_resources_callback()");
 	resources = free_smartphone_usage_list_resources_finish
 			(fso.usage, res, &count, &error);
-	_startup_check();
 	if (error) {
+		/* no need to retry... we list them again when fsousaged
+		 * (re)appears on the bus and otherwise it will tell us
+		 * about GSM via the ResourceAvailable signal */
 		if (error->code == G_DBUS_ERROR_SERVICE_UNKNOWN) {
 			g_critical("fsousaged not installed: %s", error->message);
 		}
 		else {
-			g_message("error - retrying in 1s: (%d) %s", error->code, error->message);
-			g_timeout_add(1000, _fso_list_resources, NULL);
+			g_message("error listing resources - waiting for GSM: (%d) %s",
+				  error->code, error->message);
 		}
 		g_error_free(error);
 		return;
 	}
 
+	timeline_mark(MILESTONE_RESOURCES_LISTED);
 	if (resources) {
 		int i = 0;
 		while (resources[i] != NULL) {
-			g_debug("Resource %s available", resources[i]);
+			log_debug("Resource %s available", resources[i]);
 			if (!strcmp(resources[i], "GSM")) {
 				gsm_available = TRUE;
 				break;
@@ -535,32 +1029,35 @@ _request_resource_callback(GObject *source, GAsyncResult *res, gpointer data)
 	(void) data;
 	GError *error = NULL;
 
-	g_debug("_request_resource_callback()");
+	log_debug("_request_resource_callback()");
 
 	gsm_request_running = FALSE;
-	_startup_check();
 
 	free_smartphone_usage_request_resource_finish(fso.usage, res, &error);
+	recorder_add(REC_REPLY, REC_REQUEST_GSM, error ? error->code : 0);
 	if (error == NULL) {
 		/* nothing to do when there is no error
 		 * the signal handler for ResourceChanged
 		 * will do the rest */
+		retry_reset(&gsm_request_retry);
 		return;
 	}
 
 	if (error->domain == FREE_SMARTPHONE_USAGE_ERROR &&
 		error->code == FREE_SMARTPHONE_USAGE_ERROR_USER_EXISTS) {
 		g_message("we already requested GSM!!!");
+		retry_reset(&gsm_request_retry);
+		g_error_free(error);
 		return;
 	}
 
 	/* we only request the GSM resource if it is actually
-	 * available... if this does not work we retry it after
-	 * some timeout ... */
-	g_debug("request resource error, try again in 1s");
-	g_debug("error: %s %s %d", error->message,
+	 * available... if this does not work we retry it with
+	 * increasing delays */
+	log_debug("request resource error: %s %s %d", error->message,
 		g_quark_to_string(error->domain), error->code);
-	g_timeout_add(1000, _fso_request_gsm, NULL);
+	g_error_free(error);
+	retry_schedule(&gsm_request_retry);
 }
 
 static void
@@ -571,17 +1068,22 @@ _set_functionality_callback(GObject *source, GAsyncResult *res, gpointer data)
 
 	free_smartphone_gsm_device_set_functionality_finish(fso.gsm_device,
 							    res, &error);
+	recorder_add(REC_REPLY, REC_REQUEST_SET_FUNCTIONALITY,
+		     error ? error->code : 0);
 	if (error) {
 		g_warning("SetFunctionality gave an error: %s", error->message);
-		_startup_check();
 		g_error_free(error);
 		return;
 	}
 	func_is_set = TRUE;
+	timeline_mark(MILESTONE_FUNCTIONALITY_SET);
+	/* without GSM there is no registration to wait for */
+	if (offline_mode)
+		timeline_log_summary();
 }
 
 static void
-_get_power_status_callback(GObject *source, GAsyncResult *res, gpointer data)
+_power_status_callback(GObject *source, GAsyncResult *res, gpointer data)
 {
 	(void) source;
 	(void) data;
@@ -590,13 +1092,14 @@ _get_power_status_callback(GObject *source, GAsyncResult *res, gpointer data)
 
 	status = free_smartphone_device_power_supply_get_power_status_finish
 						(fso.power_supply, res, &error);
-	g_debug("PowerStatus is %d", status);
-	if (error == NULL && (status == FREE_SMARTPHONE_DEVICE_POWER_STATUS_AC ||
-		status == FREE_SMARTPHONE_DEVICE_POWER_STATUS_CHARGING)) {
-		g_debug("not suspending due to charging or battery full");
+	if (error) {
+		g_warning("PowerStatus error: (%d) %s", error->code, error->message);
+		g_error_free(error);
 		return;
 	}
-	free_smartphone_usage_suspend(fso.usage, NULL, NULL);
+	log_debug("PowerStatus is %d", status);
+	power_status = status;
+	_suspend_update();
 }
 
 static void
@@ -614,9 +1117,10 @@ _get_idle_state_callback(GObject* source, GAsyncResult* res, gpointer data)
 		g_error_free(error);
 		return;
 	}
-	g_debug("Current IdleState is %s",
+	log_debug("Current IdleState is %s",
 		free_smartphone_device_idle_state_to_string(state));
 	if (state == FREE_SMARTPHONE_DEVICE_IDLE_STATE_SUSPEND) {
+		suspend_governor.requested = g_get_monotonic_time();
 		_fso_suspend();
 	}
 }
@@ -631,7 +1135,9 @@ _gsm_sim_sim_info_callback(GObject* source, GAsyncResult* res, gpointer data)
 	int slots_total = -1, slots_used = -1;
 	GVariant *tmp;
 
+	sim_info_running = FALSE;
 	info = free_smartphone_gsm_sim_get_sim_info_finish(fso.gsm_sim, res, &error);
+	recorder_add(REC_REPLY, REC_REQUEST_SIM_INFO, error ? error->code : 0);
 	if (error) {
 		g_warning("Failed getting SIM info: (%d) %s",
 			  error->code, error->message);
@@ -641,19 +1147,24 @@ _gsm_sim_sim_info_callback(GObject* source, GAsyncResult* res, gpointer data)
 	tmp = g_hash_table_lookup(info, "slots");
 	if (tmp) {
 		slots_total = g_variant_get_int32(tmp);
-		g_debug("SimInfo has slots total = %d", slots_total);
+		log_debug("SimInfo has slots total = %d", slots_total);
 	}
 	tmp = g_hash_table_lookup(info, "used");
 	if (tmp) {
 		slots_used = g_variant_get_int32(tmp);
-		g_debug("SimInfo has slots used = %d", slots_used);
+		log_debug("SimInfo has slots used = %d", slots_used);
 	}
 	if (slots_total == -1 || slots_used == -1) {
-		g_debug("SimInfo has no slots and/or used properties - retrying later");
-		g_timeout_add_seconds(3, _fso_sim_info, NULL);
+		log_debug("SimInfo has no slots and/or used properties - retrying later");
+		retry_schedule(&sim_info_retry);
 	}
 	else {
+		retry_reset(&sim_info_retry);
 		sim_check_needed = FALSE;
+		/* (re)seed the local slot model */
+		sim_slots_total = slots_total;
+		sim_slots_used = slots_used;
+		_sim_slots_revalidate_start();
 		if (slots_total - slots_used < MIN_SIM_SLOTS_FREE) {
 			g_message("No more free slots for messages on SIM!");
 			// TODO: verify if one free slot is needed for receiving
@@ -663,7 +1174,7 @@ _gsm_sim_sim_info_callback(GObject* source, GAsyncResult* res, gpointer data)
 				 NULL, phoneui_show_dialog_cb, NULL);
 		}
 		else {
-			g_debug("SIM has %d free slots for messages",
+			log_debug("SIM has %d free slots for messages",
 				slots_total - slots_used);
 		}
 	}
@@ -672,6 +1183,72 @@ _gsm_sim_sim_info_callback(GObject* source, GAsyncResult* res, gpointer data)
 }
 
 
+/* handlers for g_bus_watch_name */
+static enum RecorderService
+_recorder_service(const gchar *name)
+{
+	if (strcmp(name, FSO_GSM_SERVICE) == 0)
+		return REC_SERVICE_GSM;
+	if (strcmp(name, FSO_DEVICE_SERVICE) == 0)
+		return REC_SERVICE_DEVICE;
+	return REC_SERVICE_USAGE;
+}
+
+static void
+_on_fso_service_appeared(GDBusConnection *connection,
+			 const gchar *name,
+			 const gchar *name_owner,
+			 gpointer user_data)
+{
+	(void) connection;
+	(void) user_data;
+	log_debug("%s is on the bus (%s)", name, name_owner);
+	recorder_add(REC_SERVICE, _recorder_service(name), TRUE);
+
+	if (strcmp(name, FSO_USAGE_SERVICE) == 0) {
+		usage_running = TRUE;
+		if (fso_connected)
+			_usage_service_up();
+	}
+	else if (strcmp(name, FSO_GSM_SERVICE) == 0) {
+		gsm_running = TRUE;
+		if (fso_connected)
+			_gsm_service_up();
+	}
+	else if (strcmp(name, FSO_DEVICE_SERVICE) == 0) {
+		device_running = TRUE;
+		if (fso_connected)
+			_device_service_up();
+	}
+}
+
+static void
+_on_fso_service_vanished(GDBusConnection *connection,
+			 const gchar *name,
+			 gpointer user_data)
+{
+	(void) connection;
+	(void) user_data;
+	log_debug("%s is not on the bus", name);
+	recorder_add(REC_SERVICE, _recorder_service(name), FALSE);
+
+	if (strcmp(name, FSO_USAGE_SERVICE) == 0) {
+		/* resources are gone with fsousaged... have
+		 * to list them again when it comes back */
+		usage_running = FALSE;
+		gsm_available = FALSE;
+		gsm_request_running = FALSE;
+		retry_cancel(&gsm_request_retry);
+	}
+	else if (strcmp(name, FSO_GSM_SERVICE) == 0) {
+		gsm_running = FALSE;
+		_sim_slots_revalidate_stop();
+	}
+	else if (strcmp(name, FSO_DEVICE_SERVICE) == 0) {
+		device_running = FALSE;
+	}
+}
+
 /* dbus signal handlers */
 static void
 _usage_resource_available_handler(GSource *source, char *name,
@@ -679,7 +1256,7 @@ _usage_resource_available_handler(GSource *source, char *name,
 {
 	(void) source;
 	(void) data;
-	g_debug("resource %s is now %s", name,
+	log_debug("resource %s is now %s", name,
 		availability ? "available" : "vanished");
 	if (strcmp(name, "GSM") == 0) {
 		gsm_available = availability;
@@ -688,6 +1265,7 @@ _usage_resource_available_handler(GSource *source, char *name,
 		}
 		else {
 			gsm_request_running = FALSE;
+			retry_cancel(&gsm_request_retry);
 		}
 	}
 }
@@ -716,18 +1294,24 @@ _usage_resource_changed_handler(GSource *source, char *name, gboolean state,
 	(void) source;
 	(void) data;
 	GVariant *tmp;
-	g_debug("resource %s is now %s", name, state ? "enabled" : "disabled");
+	log_debug("resource %s is now %s", name, state ? "enabled" : "disabled");
+	recorder_add(REC_RESOURCE,
+		     !strcmp(name, "GSM") ? REC_RESOURCE_GSM :
+		     !strcmp(name, "Display") ? REC_RESOURCE_DISPLAY :
+		     !strcmp(name, "CPU") ? REC_RESOURCE_CPU :
+		     REC_RESOURCE_OTHER, state);
 	tmp = g_hash_table_lookup(attributes, "policy");
 	if (tmp)
-		g_debug("   policy:   %s", g_variant_get_string(tmp, NULL));
+		log_debug("   policy:   %s", g_variant_get_string(tmp, NULL));
 	tmp = g_hash_table_lookup(attributes, "refcount");
 	if (tmp)
-		g_debug("   refcount: %d", g_variant_get_int32(tmp));
+		log_debug("   refcount: %d", g_variant_get_int32(tmp));
 
 	if (strcmp(name, "Display") == 0) {
-		g_debug("Display state state changed: %s",
+		log_debug("Display state state changed: %s",
 			state ? "enabled" : "disabled");
 		display_state = state;
+		_suspend_update();
 		/* if something requests the Display resource
 		we have * to undim it */
 		if (display_state) {
@@ -737,6 +1321,10 @@ _usage_resource_changed_handler(GSource *source, char *name, gboolean state,
 	}
 
 	if (strcmp(name, "GSM") == 0) {
+		if (state)
+			timeline_mark(MILESTONE_GSM_GRANTED);
+		if (!fso.gsm_device)
+			return;
 		free_smartphone_gsm_device_get_device_status
 				(fso.gsm_device, _gsm_device_status_callback, NULL);
 		return;
@@ -748,12 +1336,21 @@ _usage_system_action_handler(GSource *source,
 			     FreeSmartphoneUsageSystemAction action,
 			     gpointer data)
 {
-	g_debug("SystemAction: %d", action);
+	log_debug("SystemAction: %d", action);
+	recorder_add(REC_SYSTEM_ACTION, action, 0);
+	if (action == FREE_SMARTPHONE_USAGE_SYSTEM_ACTION_RESUME) {
+		wake_resumed();
+		return;
+	}
+	if (action != FREE_SMARTPHONE_USAGE_SYSTEM_ACTION_SUSPEND)
+		return;
+
+	wake_suspending();
+	log_flush();
+	config_flush();
 	/* show the IdleScreen if configured to do so on suspend */
-	if (action == FREE_SMARTPHONE_USAGE_SYSTEM_ACTION_SUSPEND &&
-		idle_screen & IDLE_SCREEN_SUSPEND)  {
-		phoneui_idle_screen_call_display
-			(phoneui.idle_screen, NULL, phoneui_show_idle_cb, NULL);
+	if (idle_screen & IDLE_SCREEN_SUSPEND)  {
+		phonefsod_idle_screen_show();
 	}
 }
 
@@ -764,14 +1361,18 @@ _device_idle_notifier_state_handler(GSource *source,
 {
 	(void) source;
 	(void) data;
+	recorder_add(REC_IDLE_STATE, state, 0);
+	idle_state = state;
 
 	/* while Display resource is requested nothing to do */
 	if (display_state && state != FREE_SMARTPHONE_DEVICE_IDLE_STATE_BUSY) {
-		g_debug("Not handling Idle while Display is requested");
+		log_debug("Not handling Idle while Display is requested");
 		return;
 	}
 	switch (state) {
 	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_BUSY:
+		/* the user is touching things... maybe the idle screen */
+		phonefsod_idle_screen_invalidate();
 		fso_dimit(100, dim_screen);
 		break;
 	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_IDLE:
@@ -786,14 +1387,12 @@ _device_idle_notifier_state_handler(GSource *source,
 	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_LOCK:
 		if (idle_screen & IDLE_SCREEN_LOCK &&
 				((idle_screen & IDLE_SCREEN_PHONE) ||
-				 ((incoming_calls_size == 0) &&
-				 (outgoing_calls_size == 0)))) {
-			phoneui_idle_screen_call_display
-				(phoneui.idle_screen, NULL,
-				 phoneui_show_idle_cb, NULL);
+				 (calls_total() == 0))) {
+			phonefsod_idle_screen_show();
 		}
 		break;
 	case FREE_SMARTPHONE_DEVICE_IDLE_STATE_SUSPEND:
+		suspend_governor.requested = g_get_monotonic_time();
 		_fso_suspend();
 		break;
 	}
@@ -806,12 +1405,13 @@ _device_input_event_handler(GSource *source, char *src,
 {
 	(void) source;
 	(void) data;
-	g_debug("INPUT EVENT: %s - %d - %d", src, state, duration);
+	log_debug("INPUT EVENT: %s - %d - %d", src, state, duration);
+	recorder_add(REC_INPUT, state, duration);
+	wake_signal(WAKE_CAUSE_INPUT);
 	if (idle_screen & IDLE_SCREEN_AUX &&
 		!strcmp(src, "AUX") &&
 		state == FREE_SMARTPHONE_DEVICE_INPUT_STATE_RELEASED) {
-		phoneui_idle_screen_call_toggle(phoneui.idle_screen, NULL,
-						    phoneui_toggle_idle_cb, NULL);
+		phonefsod_idle_screen_toggle();
 	}
 	if (quick_settings_power && !strcmp(src, "POWER") &&
 		state == FREE_SMARTPHONE_DEVICE_INPUT_STATE_RELEASED) {
@@ -820,99 +1420,109 @@ _device_input_event_handler(GSource *source, char *src,
 	}
 }
 
+static void
+_device_power_status_handler(GSource *source,
+			     FreeSmartphoneDevicePowerStatus status,
+			     gpointer data)
+{
+	(void) source;
+	(void) data;
+	log_debug("PowerStatus changed to %d", status);
+	recorder_add(REC_POWER_STATUS, status, 0);
+	power_status = status;
+	_suspend_update();
+}
+
 static void
 _gsm_call_status_handler(GSource *source, int call_id, int status,
 		     GHashTable *properties, gpointer data)
 {
-	g_debug("call status handler called, id: %d, status: %d", call_id,
-		status);
+	call_t *call;
+	const gchar *number = NULL;
 
-	GVariant *peerNumber = g_hash_table_lookup(properties, "peer");
-	gchar *number;
-	if (peerNumber != NULL) {
-		gsize len;
-		number = g_variant_dup_string(peerNumber, &len);
-		/* FIXME: fix the ugly " bug
-		 * we potentially waste a couple of bytes, fix it in a normal manner*/
-		if (number[0] == '"') {
-			gchar *tmp;
-			tmp = strdup(number);
-			strcpy(number, &tmp[1]);
-			len--;
-		}
-		if (len > 0 && number[len - 1] == '"') {
-			number[len - 1] = '\0';
-		}
+	log_debug("call status handler called, id: %d, status: %d", call_id,
+		status);
+	recorder_add(REC_CALL_STATUS, call_id, status);
 
-	}
-	else {
-		number = "*****";
-	}
+	call = calls_lookup(call_id);
 
 	switch (status) {
 		case FREE_SMARTPHONE_GSM_CALL_STATUS_INCOMING:
-			g_debug("incoming call");
-			if (_call_check(incoming_calls,
-					&incoming_calls_size, call_id) == -1) {
-				_call_add(&incoming_calls,
-					&incoming_calls_size, call_id);
+			log_debug("incoming call");
+			wake_signal(WAKE_CAUSE_CALL);
+			if (call == NULL) {
+				GVariant *peer = g_hash_table_lookup(properties, "peer");
+				if (peer != NULL)
+					number = g_variant_get_string(peer, NULL);
+				call = calls_add(call_id, CALL_DIRECTION_INCOMING,
+						 number);
+				if (call == NULL)
+					break;
 				fso_dimit(100, DIM_SCREEN_ALWAYS);
 				free_smartphone_usage_request_resource
 					(fso.usage, "CPU", NULL, NULL);
 				phoneui_call_management_call_display_incoming
 					(phoneui.call_management,
-					call_id, status, number,
-					NULL, phoneui_show_incoming_cb, NULL);
+					call_id, status, call->peer,
+					NULL, phoneui_show_incoming_cb,
+					GINT_TO_POINTER(call_id));
 			}
 			break;
 		case FREE_SMARTPHONE_GSM_CALL_STATUS_OUTGOING:
-			g_debug("outgoing call");
-			if (_call_check(outgoing_calls,
-					&outgoing_calls_size, call_id) == -1) {
-				_call_add(&outgoing_calls,
-					&outgoing_calls_size, call_id);
+			log_debug("outgoing call");
+			if (call == NULL) {
+				GVariant *peer = g_hash_table_lookup(properties, "peer");
+				if (peer != NULL)
+					number = g_variant_get_string(peer, NULL);
+				call = calls_add(call_id, CALL_DIRECTION_OUTGOING,
+						 number);
+				if (call == NULL)
+					break;
 				free_smartphone_usage_request_resource
 					(fso.usage, "CPU", NULL, NULL);
 				phoneui_call_management_call_display_outgoing
 					(phoneui.call_management,
-					call_id, status, number,
+					call_id, status, call->peer,
 					NULL, phoneui_show_outgoing_cb, NULL);
 			}
 			break;
 		case FREE_SMARTPHONE_GSM_CALL_STATUS_RELEASE:
-			g_debug("release call");
-			if (_call_check(incoming_calls,
-					&incoming_calls_size, call_id) != -1) {
-				_call_remove(&incoming_calls,
-						&incoming_calls_size, call_id);
-				phoneui_call_management_call_hide_incoming
-					(phoneui.call_management,
-					 call_id,
-					 NULL, phoneui_hide_incoming_cb, NULL);
-			}
-			if (_call_check(outgoing_calls,
-					&outgoing_calls_size, call_id) != -1) {
-				_call_remove(&outgoing_calls,
-						&outgoing_calls_size, call_id);
-				phoneui_call_management_call_hide_outgoing
-					(phoneui.call_management, call_id,
-					 NULL, phoneui_hide_outgoing_cb, NULL);
+			log_debug("release call");
+			if (call != NULL) {
+				calls_set_state(call, CALL_STATE_RELEASE);
+				if (call->direction == CALL_DIRECTION_INCOMING) {
+					phoneui_call_management_call_hide_incoming
+						(phoneui.call_management,
+						 call_id,
+						 NULL, phoneui_hide_incoming_cb, NULL);
+				}
+				else {
+					phoneui_call_management_call_hide_outgoing
+						(phoneui.call_management, call_id,
+						 NULL, phoneui_hide_outgoing_cb, NULL);
+				}
+				calls_remove(call);
 			}
-			if (incoming_calls_size == 0 && outgoing_calls_size == 0) {
+			if (calls_total() == 0) {
 				free_smartphone_usage_release_resource
 					(fso.usage, "CPU", NULL, NULL);
 			}
 			break;
 		case FREE_SMARTPHONE_GSM_CALL_STATUS_HELD:
-			g_debug("held call");
+			log_debug("held call");
+			if (call != NULL)
+				calls_set_state(call, CALL_STATE_HELD);
 			break;
 		case FREE_SMARTPHONE_GSM_CALL_STATUS_ACTIVE:
-			g_debug("active call");
+			log_debug("active call");
+			if (call != NULL)
+				calls_set_state(call, CALL_STATE_ACTIVE);
 			break;
 		default:
-			g_debug("Unknown CallStatus");
+			log_debug("Unknown CallStatus");
 			break;
 	}
+	_suspend_update();
 }
 
 static void
@@ -922,8 +1532,9 @@ _gsm_device_status_handler(GSource *source,
 {
 	(void) data;
 	(void) source;
-	g_debug("_gsm_device_status_handler: status=%s",
+	log_debug("_gsm_device_status_handler: status=%s",
 		 free_smartphone_gsm_device_status_to_string(status));
+	recorder_add(REC_DEVICE_STATUS, status, 0);
 	if (status == FREE_SMARTPHONE_GSM_DEVICE_STATUS_ALIVE_NO_SIM) {
 		if (show_sim_not_present)
 		{
@@ -934,11 +1545,12 @@ _gsm_device_status_handler(GSource *source,
 		}
 	}
 	else if (status == FREE_SMARTPHONE_GSM_DEVICE_STATUS_ALIVE_SIM_LOCKED) {
+		timeline_mark(MILESTONE_SIM_LOCKED);
 		if (sim_pin) {
 			fso_set_functionality();
 		}
 		else {
-			g_debug("SIM auth needed... showing PIN dialog");
+			log_debug("SIM auth needed... showing PIN dialog");
 			sim_auth_needed = TRUE;
 			phoneui_notification_call_display_sim_auth
 				(phoneui.notification, status, NULL,
@@ -946,7 +1558,8 @@ _gsm_device_status_handler(GSource *source,
 		}
 	}
 	else if (status == FREE_SMARTPHONE_GSM_DEVICE_STATUS_ALIVE_SIM_READY) {
-		g_debug("SIM is alive-sim-ready");
+		log_debug("SIM is alive-sim-ready");
+		timeline_mark(MILESTONE_SIM_READY);
 		sim_auth_needed = FALSE;
 		if (!func_is_set) {
 			fso_set_functionality();
@@ -956,10 +1569,11 @@ _gsm_device_status_handler(GSource *source,
 		}
 	}
 	else if (status == FREE_SMARTPHONE_GSM_DEVICE_STATUS_ALIVE_REGISTERED) {
-		g_debug("alive-registered");
+		log_debug("alive-registered");
+		timeline_mark(MILESTONE_REGISTERED);
+		timeline_log_summary();
 		fso_pdp_set_credentials();
-		free_smartphone_gsm_network_set_calling_identification
-			(fso.gsm_network, calling_identification, NULL, NULL);
+		fso_set_calling_identification();
 	}
 }
 
@@ -968,15 +1582,25 @@ _pim_incoming_message_handler(GSource *source, char *message_path, gpointer data
 {
 	(void) source;
 	(void) data;
-	g_debug("fso_incoming_message_handler(%s)", message_path);
+	log_debug("fso_incoming_message_handler(%s)", message_path);
+	wake_signal(WAKE_CAUSE_SMS);
+	recorder_add(REC_INCOMING_MESSAGE, 0, 0);
 	if (show_incoming_sms) {
 		phoneui_messages_call_display_message
 			(phoneui.messages, message_path, NULL,
 			 phoneui_display_message_cb, NULL);
 	}
-	/* check if there is still a free slot for the next SMS */
-	free_smartphone_gsm_sim_get_sim_info
-				(fso.gsm_sim, _gsm_sim_sim_info_callback, NULL);
+	/* check if there is still a free slot for the next SMS... the
+	 * estimate is only verified with the SIM when it gets low */
+	if (sim_slots_total < 0) {
+		/* not seeded yet - the pending SimInfo will do it */
+		return;
+	}
+	sim_slots_used++;
+	log_debug("estimating %d free slots on SIM", sim_slots_total - sim_slots_used);
+	if (sim_slots_total - sim_slots_used <= SIM_SLOTS_LOW_WATERMARK) {
+		_fso_sim_info();
+	}
 }
 
 static void
@@ -985,8 +1609,10 @@ _gsm_network_incoming_ussd_handler(GSource *source, int mode,
 {
 	(void) source;
 	(void) data;
-	g_debug("fso_incoming_ussd_handler(mode=%d, message=%s)", mode,
+	log_debug("fso_incoming_ussd_handler(mode=%d, message=%s)", mode,
 		message);
+	wake_signal(WAKE_CAUSE_USSD);
+	recorder_add(REC_USSD, mode, 0);
 	phoneui_notification_call_display_ussd
 		(phoneui.notification, mode, message, NULL,
 		 phoneui_show_ussd_cb, NULL);
@@ -998,107 +1624,237 @@ _gsm_network_status_handler(GSource *source, GHashTable *status, gpointer data)
 	(void) source;
 	(void) data;
 
+	wake_signal(WAKE_CAUSE_NETWORK);
 	if (!status) {
-		g_debug("got no status from NetworkStatus?!");
-		return;
-	}
-
-	/* right now we use this signal only to check if it registered on startup
-	to reset the startup time... nothing to do if it is already reset */
-	if (startup_time == -1) {
+		log_debug("got no status from NetworkStatus?!");
 		return;
 	}
 
 	GVariant *tmp = g_hash_table_lookup(status, "registration");
 	if (tmp) {
 		const char *registration = g_variant_get_string(tmp, NULL);
-		g_debug("fso_network_status_handler(registration=%s)",
+		log_debug("fso_network_status_handler(registration=%s)",
 				registration);
-		if (strcmp(registration, "unregistered")) {
+		recorder_add(REC_NETWORK_STATUS,
+			     strcmp(registration, "unregistered") != 0, 0);
+		_reregister_update(registration);
+
+		/* besides the watchdog we use this signal only to check if it
+		registered on startup to end the startup phase early */
+		if (startup.active && strcmp(registration, "unregistered")) {
 			g_message("Ending startup phase due to successfull registration");
 			_stop_startup();
-			return;
 		}
 	}
 	else {
-		g_debug("got NetworkStatus without registration?!?");
+		log_debug("got NetworkStatus without registration?!?");
 	}
+}
 
-	_startup_check();
+/* network re-registration watchdog
+ * if the registration stays unregistered or denied for longer than
+ * gsm_reregister_timeout we ask the modem to register again... and keep
+ * doing so with increasing delays until it is registered again */
+static void
+_reregister_update(const char *registration)
+{
+	gint64 now;
+
+	if (!strcmp(registration, "unregistered") ||
+			!strcmp(registration, "denied")) {
+		if (reregister.lost_since || offline_mode)
+			return;
+		reregister.lost_since = g_get_monotonic_time();
+		reregister.attempts = 0;
+		reregister.outages++;
+		g_message("Network registration lost (%s) - re-registering in %ds",
+			  registration, gsm_reregister_timeout);
+		reregister.timeout_id = g_timeout_add_seconds
+			(gsm_reregister_timeout, _fso_network_register, NULL);
+	}
+	else if (!strcmp(registration, "home") ||
+			!strcmp(registration, "roaming")) {
+		if (!reregister.lost_since)
+			return;
+		now = g_get_monotonic_time();
+		reregister.last_recovery = now - reregister.lost_since;
+		if (reregister.last_recovery > reregister.max_recovery)
+			reregister.max_recovery = reregister.last_recovery;
+		reregister.recoveries++;
+		g_message("Network registration recovered after %" G_GINT64_FORMAT
+			  "s and %u attempts", reregister.last_recovery / G_USEC_PER_SEC,
+			  reregister.attempts);
+		_reregister_stop();
+	}
+	/* anything else (busy, unknown) means the modem is still
+	 * trying on its own... leave the watchdog alone */
 }
 
 static void
-_stop_startup()
+_reregister_stop()
 {
-	startup_time = -1;
+	if (reregister.timeout_id) {
+		g_source_remove(reregister.timeout_id);
+		reregister.timeout_id = 0;
+	}
+	retry_reset(&reregister_retry);
+	reregister.lost_since = 0;
+}
 
-	/* we have to check the current idle state... and if it is suspend
-	then we have to suspend... otherwise it would never suspend without
-	touching the screen */
-	g_debug("Getting current IdleState to see if we have to suspend");
-	free_smartphone_device_idle_notifier_get_state(fso.idle_notifier,
-						_get_idle_state_callback, NULL);
+static gboolean
+_fso_network_register()
+{
+	reregister.timeout_id = 0;
+	if (!reregister.lost_since || offline_mode || !fso.gsm_network)
+		return FALSE;
+
+	reregister.attempts++;
+	reregister.total_attempts++;
+	g_message("Trying to re-register to the network (attempt %u)",
+		  reregister.attempts);
+	recorder_add(REC_REQUEST, REC_REQUEST_REGISTER, reregister.attempts);
+	free_smartphone_gsm_network_register(fso.gsm_network,
+					     _network_register_callback, NULL);
+	return FALSE;
 }
 
 static void
-_startup_check()
+_network_register_callback(GObject *source, GAsyncResult *res, gpointer data)
 {
-	time_t now;
+	(void) source;
+	(void) data;
+	GError *error = NULL;
 
-	if (startup_time == -1) {
-		return;
+	free_smartphone_gsm_network_register_finish(fso.gsm_network, res, &error);
+	recorder_add(REC_REPLY, REC_REQUEST_REGISTER, error ? error->code : 0);
+	if (error) {
+		g_warning("Re-registering failed: (%d) %s",
+			  error->code, error->message);
+		g_error_free(error);
 	}
 
-	now = time(NULL);
-	if (now - startup_time > inhibit_suspend_on_startup_time) {
-		g_message("Ending startup phase due to time out");
-		_stop_startup();
+	/* registered again is reported by the status signal... as long
+	 * as that did not happen try again later */
+	if (reregister.lost_since) {
+		retry_schedule(&reregister_retry);
 	}
 }
 
-/* call management */
-static void
-_call_add(call_t ** calls, int *size, int id)
+/* a{sx} with the statistics of the watchdog, durations in ms */
+GVariant *
+fso_reregister_stats_to_variant()
 {
-	g_debug("_call_add(%d)", id);
-	(*size)++;
-	if (*size == 1)
-		*calls = malloc(sizeof(call_t));
-	else
-		*calls = realloc(*calls, sizeof(call_t) * (*size));
-	(*calls)[(*size) - 1].id = id;
+	GVariantBuilder builder;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sx}"));
+	g_variant_builder_add(&builder, "{sx}", "outages",
+			      (gint64) reregister.outages);
+	g_variant_builder_add(&builder, "{sx}", "recoveries",
+			      (gint64) reregister.recoveries);
+	g_variant_builder_add(&builder, "{sx}", "attempts",
+			      (gint64) reregister.total_attempts);
+	g_variant_builder_add(&builder, "{sx}", "last-recovery-ms",
+			      reregister.last_recovery / 1000);
+	g_variant_builder_add(&builder, "{sx}", "max-recovery-ms",
+			      reregister.max_recovery / 1000);
+	g_variant_builder_add(&builder, "{sx}", "current-outage-ms",
+			      reregister.lost_since ?
+			      (g_get_monotonic_time() - reregister.lost_since) / 1000 : 0);
+
+	return g_variant_builder_end(&builder);
 }
 
-static int
-_call_check(call_t * calls, int *size, int id)
+/* a{sx} with the counters of the brightness controller */
+GVariant *
+fso_brightness_stats_to_variant()
 {
-	int i;
-	g_debug("_call_check(%d)", id);
-	for (i = 0; i < (*size); i++) {
-		if (calls[i].id == id)
-			return i;
-	}
-	return -1;
+	GVariantBuilder builder;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sx}"));
+	g_variant_builder_add(&builder, "{sx}", "level",
+			      (gint64) brightness.applied);
+	g_variant_builder_add(&builder, "{sx}", "issued",
+			      (gint64) brightness.issued);
+	g_variant_builder_add(&builder, "{sx}", "unchanged",
+			      (gint64) brightness.unchanged);
+	g_variant_builder_add(&builder, "{sx}", "coalesced",
+			      (gint64) brightness.coalesced);
+	g_variant_builder_add(&builder, "{sx}", "suppressed",
+			      (gint64) brightness.unchanged + brightness.coalesced);
+	g_variant_builder_add(&builder, "{sx}", "phoneui-skipped",
+			      (gint64) phonefsod_phoneui_calls_skipped());
+
+	return g_variant_builder_end(&builder);
+}
+
+/* a(suxxxau) with the time from the SUSPEND idle state to
+ * actually requesting the suspend and the time spent suspended */
+GVariant *
+fso_suspend_metrics_to_variant()
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(suxxxau)"));
+	g_variant_builder_add_value(&builder,
+			histogram_to_variant(&suspend_governor.latency));
+	g_variant_builder_add_value(&builder, wake_duration_to_variant());
+
+	return g_variant_builder_end(&builder);
+}
+
+/* (bs) whether we may suspend and why not */
+GVariant *
+fso_suspend_eligibility_to_variant()
+{
+	return g_variant_new("(bs)", suspend_governor.eligible,
+			     suspend_governor.blocker ? suspend_governor.blocker : "");
 }
 
 static void
-_call_remove(call_t ** calls, int *size, int id)
+_stop_startup()
 {
-	g_debug("_call_remove(%d)", id);
-	if (*size == 1) {
-		free(*calls);
-		(*size)--;
-		*calls = NULL;
+	/* eg. going offline after the startup phase ended */
+	if (!startup.active)
+		return;
+
+	startup.active = FALSE;
+	if (startup.timeout_id) {
+		g_source_remove(startup.timeout_id);
+		startup.timeout_id = 0;
 	}
-	else {
-		int place = _call_check(*calls, size, id);
-		if (place >= 0) {
-			int i = place;
-			for (i = place; i + 1 < (*size); i++) {
-				(*calls)[i].id = (*calls)[i + 1].id;
-			}
-			(*size)--;
-			*calls = realloc(*calls, sizeof(call_t) * (*size));
-		}
+	_suspend_update();
+
+	/* we have to check the current idle state... and if it is suspend
+	then we have to suspend... otherwise it would never suspend without
+	touching the screen */
+	if (!fso.idle_notifier)
+		return;
+	log_debug("Getting current IdleState to see if we have to suspend");
+	free_smartphone_device_idle_notifier_get_state(fso.idle_notifier,
+						_get_idle_state_callback, NULL);
+}
+
+static gboolean
+_startup_timeout(gpointer data)
+{
+	(void) data;
+	g_message("Ending startup phase due to time out");
+	startup.timeout_id = 0;
+	_stop_startup();
+	return FALSE;
+}
+
+/* (bx) whether suspend is inhibited for the startup phase
+ * and how many ms are left of it */
+GVariant *
+fso_startup_inhibit_to_variant()
+{
+	gint64 remaining = 0;
+
+	if (startup.active) {
+		remaining = (startup.deadline - g_get_monotonic_time()) / 1000;
+		if (remaining < 0)
+			remaining = 0;
 	}
+	return g_variant_new("(bx)", startup.active, remaining);
 }
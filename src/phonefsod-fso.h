@@ -19,6 +19,7 @@
 #include <glib.h>
 
 gboolean fso_init();
+void fso_shutdown();
 void fso_connect_usage();
 void fso_connect_gsm();
 void fso_connect_pim();
@@ -29,5 +30,14 @@ void fso_dimit(int percent, int dim);
 void fso_get_resource_state(const char *resource, void (*callback)(GError *, gboolean, gpointer), gpointer data);
 gboolean fso_set_functionality();
 void fso_pdp_set_credentials();
+void fso_set_calling_identification();
+void fso_redim();
+void fso_suspend_update();
+void fso_reregister_timeout_update();
+GVariant *fso_reregister_stats_to_variant();
+GVariant *fso_brightness_stats_to_variant();
+GVariant *fso_suspend_metrics_to_variant();
+GVariant *fso_suspend_eligibility_to_variant();
+GVariant *fso_startup_inhibit_to_variant();
 
 #endif
@@ -22,6 +22,9 @@
 #include <freesmartphone.h>
 #include <shr-bindings.h>
 
+/* path of the configuration file in use */
+char *config_file;
+
 gboolean offline_mode;
 gboolean quick_settings_power;
 gboolean sim_auth_needed;
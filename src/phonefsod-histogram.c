@@ -0,0 +1,54 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#include <glib.h>
+#include "phonefsod-histogram.h"
+
+void
+histogram_add(histogram_t *histogram, gint64 usec)
+{
+	gint64 ms = usec / 1000;
+	int bucket = 0;
+
+	if (ms < 0)
+		ms = 0;
+	while (bucket < HISTOGRAM_BUCKETS - 1 && ms >= ((gint64) 1 << bucket))
+		bucket++;
+
+	histogram->buckets[bucket]++;
+	if (!histogram->count || ms < histogram->min)
+		histogram->min = ms;
+	if (ms > histogram->max)
+		histogram->max = ms;
+	histogram->sum += ms;
+	histogram->count++;
+}
+
+/* (suxxxau) of name, count, sum, min and max in ms and the buckets */
+GVariant *
+histogram_to_variant(histogram_t *histogram)
+{
+	GVariantBuilder buckets;
+	int i;
+
+	g_variant_builder_init(&buckets, G_VARIANT_TYPE("au"));
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+		g_variant_builder_add(&buckets, "u", histogram->buckets[i]);
+
+	return g_variant_new("(suxxxau)", histogram->name, histogram->count,
+			     histogram->sum, histogram->min, histogram->max,
+			     &buckets);
+}
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_HISTOGRAM_H
+#define _PHONEFSOD_HISTOGRAM_H
+
+#include <glib.h>
+
+/* bucket i counts durations below 2^i ms, the last one everything
+ * above... which covers everything from <1ms up to ~2h */
+#define HISTOGRAM_BUCKETS 24
+
+typedef struct {
+	const char *name;
+	guint count;
+	gint64 sum;	/* all in ms */
+	gint64 min;
+	gint64 max;
+	guint buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+#define HISTOGRAM_INIT(name) { name, 0, 0, 0, 0, { 0 } }
+
+void histogram_add(histogram_t *histogram, gint64 usec);
+GVariant *histogram_to_variant(histogram_t *histogram);
+
+#endif
@@ -0,0 +1,511 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+/*
+ * Logging without blocking the caller on file I/O.
+ *
+ * Messages are copied into a bounded lock-free ring (one slot per
+ * record, each with a sequence number telling whose turn it is) and
+ * written out by a thread of their own, batched into writev() calls.
+ * The writer wakes up once per LOG_FLUSH_INTERVAL or when kicked via
+ * an eventfd - which happens for warnings and worse, when the ring
+ * fills up and when a flush is requested before suspending.
+ * When the ring is full records are dropped rather than waited for.
+ *
+ * Messages logged through log_debug() and log_info() do not go through
+ * GLib at all: the level of their domain is checked before the message
+ * is formatted, so disabled ones cost nothing.
+ *
+ * The writer also keeps the log bounded: when writing a batch would
+ * grow the file beyond max_size it is rotated to path.1 ... path.N
+ * first, dropping the oldest one.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <glib.h>
+#include "phonefsod-log.h"
+
+/* must be a power of 2 */
+#define LOG_RING_SIZE 128
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_RECORD_MAX 512
+#define LOG_DOMAIN_MAX 16
+#define LOG_PREFIX_MAX 64
+#define LOG_BATCH_MAX 64
+/* ms the writer sleeps when not kicked */
+#define LOG_FLUSH_INTERVAL 1000
+
+#define LOG_URGENT (G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING)
+
+typedef struct {
+	volatile gint seq;
+	gint64 time;		/* realtime us */
+	GLogLevelFlags level;
+	char domain[LOG_DOMAIN_MAX];
+	char text[LOG_RECORD_MAX];
+	gsize len;
+	char prefix[LOG_PREFIX_MAX];	/* filled in by the writer */
+} log_record_t;
+
+static struct {
+	log_record_t records[LOG_RING_SIZE];
+	volatile gint head;	/* next position to claim */
+	volatile gint tail;	/* next position to write out */
+	volatile gint dropped;
+	volatile gint sync;	/* fdatasync after the next batch */
+	volatile gint running;
+	volatile gint reopen;	/* reopen the file before the next batch */
+	int fd;
+	int event_fd;
+	GThread *thread;
+	char *path;
+	gsize max_size;		/* bytes, 0 for no limit */
+	int max_files;		/* rotated files kept */
+	gsize size;		/* of the current file */
+} ring = { .fd = -1, .event_fd = -1 };
+
+GLogLevelFlags log_levels[LOG_DOMAIN_COUNT];
+
+static const char *domain_names[LOG_DOMAIN_COUNT] = {
+	[LOG_DOMAIN_MAIN] = "main",
+	[LOG_DOMAIN_FSO] = "fso",
+	[LOG_DOMAIN_CALLS] = "calls",
+	[LOG_DOMAIN_DBUS] = "dbus",
+};
+
+/* only touched by the writer thread */
+static time_t cached_sec = -1;
+static char cached_date[30];
+static guint reported_dropped = 0;
+
+
+static const char *
+_level_name(GLogLevelFlags level)
+{
+	switch (level & G_LOG_LEVEL_MASK) {
+	case G_LOG_LEVEL_ERROR:
+		return "ERROR";
+	case G_LOG_LEVEL_CRITICAL:
+		return "CRITICAL";
+	case G_LOG_LEVEL_WARNING:
+		return "WARNING";
+	case G_LOG_LEVEL_MESSAGE:
+		return "MESSAGE";
+	case G_LOG_LEVEL_INFO:
+		return "INFO";
+	case G_LOG_LEVEL_DEBUG:
+		return "DEBUG";
+	default:
+		return "";
+	}
+}
+
+/* formats the line prefix... the date only changes once a second */
+static gsize
+_format_prefix(char *prefix, gint64 time, const char *domain,
+	       GLogLevelFlags level)
+{
+	time_t sec = time / G_USEC_PER_SEC;
+	int len;
+
+	if (sec != cached_sec) {
+		struct tm ptime;
+		localtime_r(&sec, &ptime);
+		strftime(cached_date, sizeof(cached_date), "%Y.%m.%d %T", &ptime);
+		cached_sec = sec;
+	}
+	len = snprintf(prefix, LOG_PREFIX_MAX, "%s.%06d [%s]\t%s: ",
+		       cached_date, (int) (time % G_USEC_PER_SEC),
+		       domain, _level_name(level));
+	return MIN(len, LOG_PREFIX_MAX - 1);
+}
+
+static int
+_open_log()
+{
+	struct stat st;
+	int fd;
+
+	fd = open(ring.path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return -1;
+	ring.size = fstat(fd, &st) == 0 ? st.st_size : 0;
+	return fd;
+}
+
+/* switches to a new file... keeping the old ones if asked to */
+static void
+_reopen(gboolean rotate)
+{
+	int fd;
+	int i;
+
+	close(ring.fd);
+	if (rotate) {
+		if (ring.max_files > 0) {
+			char *from, *to;
+			for (i = ring.max_files - 1; i > 0; i--) {
+				from = g_strdup_printf("%s.%d", ring.path, i);
+				to = g_strdup_printf("%s.%d", ring.path, i + 1);
+				rename(from, to);
+				g_free(from);
+				g_free(to);
+			}
+			to = g_strdup_printf("%s.1", ring.path);
+			rename(ring.path, to);
+			g_free(to);
+		}
+		else {
+			unlink(ring.path);
+		}
+	}
+
+	fd = _open_log();
+	/* better keep writing to the unlinked file than to nothing */
+	ring.fd = fd >= 0 ? fd : open("/dev/null", O_WRONLY | O_CLOEXEC);
+}
+
+static void
+_writev_all(int fd, struct iovec *iov, int count)
+{
+	while (count > 0) {
+		ssize_t written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		/* skip what got written and retry the rest */
+		while (count > 0 && (size_t) written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+}
+
+/* writes out everything that is ready, returns FALSE if there was nothing */
+static gboolean
+_drain()
+{
+	/* three per record plus the dropped line */
+	struct iovec iov[LOG_BATCH_MAX * 3 + 1];
+	char dropped_line[64];
+	gint tail = g_atomic_int_get(&ring.tail);
+	gint pos = tail;
+	int count = 0, n = 0, i;
+	guint dropped;
+	gsize len = 0;
+
+	dropped = (guint) g_atomic_int_get(&ring.dropped);
+	if (dropped != reported_dropped) {
+		int len = snprintf(dropped_line, sizeof(dropped_line),
+				   "*** %u log records dropped ***\n",
+				   dropped - reported_dropped);
+		iov[n].iov_base = dropped_line;
+		iov[n++].iov_len = len;
+		reported_dropped = dropped;
+	}
+
+	while (count < LOG_BATCH_MAX) {
+		log_record_t *record = &ring.records[pos & LOG_RING_MASK];
+		if (g_atomic_int_get(&record->seq) != pos + 1)
+			break;
+		iov[n].iov_base = record->prefix;
+		iov[n++].iov_len = _format_prefix(record->prefix, record->time,
+						  record->domain, record->level);
+		iov[n].iov_base = record->text;
+		iov[n++].iov_len = record->len;
+		iov[n].iov_base = "\n";
+		iov[n++].iov_len = 1;
+		pos++;
+		count++;
+	}
+	if (n == 0)
+		return FALSE;
+
+	for (i = 0; i < n; i++)
+		len += iov[i].iov_len;
+	if (ring.max_size && ring.size && ring.size + len > ring.max_size)
+		_reopen(TRUE);
+	_writev_all(ring.fd, iov, n);
+	ring.size += len;
+
+	/* hand the slots back to the producers */
+	for (; tail != pos; tail++) {
+		g_atomic_int_set(&ring.records[tail & LOG_RING_MASK].seq,
+				 tail + LOG_RING_SIZE);
+	}
+	g_atomic_int_set(&ring.tail, pos);
+	return count == LOG_BATCH_MAX;
+}
+
+static void
+_kick()
+{
+	guint64 one = 1;
+
+	if (write(ring.event_fd, &one, sizeof(one)) < 0) {
+		/* counter full means the writer is kicked already */
+	}
+}
+
+static gpointer
+_writer_thread(gpointer data)
+{
+	struct pollfd pfd;
+	guint64 value;
+
+	(void) data;
+	pfd.fd = ring.event_fd;
+	pfd.events = POLLIN;
+
+	while (g_atomic_int_get(&ring.running)) {
+		if (poll(&pfd, 1, LOG_FLUSH_INTERVAL) > 0) {
+			if (read(ring.event_fd, &value, sizeof(value)) < 0) {
+				/* nothing to clear */
+			}
+		}
+		if (g_atomic_int_compare_and_exchange(&ring.reopen, 1, 0))
+			_reopen(FALSE);
+		while (_drain())
+			;
+		if (g_atomic_int_compare_and_exchange(&ring.sync, 1, 0))
+			fdatasync(ring.fd);
+	}
+
+	/* write out whatever is left */
+	while (_drain())
+		;
+	fdatasync(ring.fd);
+	return NULL;
+}
+
+/* writes a record right away from the calling thread... used when
+ * the writer is not running or we are about to abort */
+static void
+_write_direct(const gchar *domain, GLogLevelFlags level, const gchar *message)
+{
+	struct iovec iov[3];
+	char prefix[LOG_PREFIX_MAX];
+	char date[30];
+	struct tm ptime;
+	gint64 now = g_get_real_time();
+	time_t sec = now / G_USEC_PER_SEC;
+	int len;
+
+	localtime_r(&sec, &ptime);
+	strftime(date, sizeof(date), "%Y.%m.%d %T", &ptime);
+	len = snprintf(prefix, sizeof(prefix), "%s.%06d [%s]\t%s: ", date,
+		       (int) (now % G_USEC_PER_SEC), domain, _level_name(level));
+	iov[0].iov_base = prefix;
+	iov[0].iov_len = MIN(len, LOG_PREFIX_MAX - 1);
+	iov[1].iov_base = (char *) message;
+	iov[1].iov_len = strlen(message);
+	iov[2].iov_base = "\n";
+	iov[2].iov_len = 1;
+	_writev_all(ring.fd, iov, 3);
+}
+
+gboolean
+log_init(const char *path, gsize max_size, int max_files)
+{
+	GError *error = NULL;
+	int i;
+
+	ring.path = g_strdup(path);
+	ring.max_size = max_size;
+	ring.max_files = max_files;
+	ring.fd = _open_log();
+	if (ring.fd < 0)
+		return FALSE;
+	ring.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ring.event_fd < 0) {
+		close(ring.fd);
+		ring.fd = -1;
+		return FALSE;
+	}
+
+	for (i = 0; i < LOG_RING_SIZE; i++)
+		ring.records[i].seq = i;
+	ring.head = ring.tail = 0;
+	ring.running = 1;
+	ring.thread = g_thread_create(_writer_thread, NULL, TRUE, &error);
+	if (error) {
+		/* still log... just synchronously */
+		g_error_free(error);
+		ring.running = 0;
+		ring.thread = NULL;
+	}
+	return TRUE;
+}
+
+/* lets the writer reopen the file... after it was moved away by
+ * an external logrotate for example */
+void
+log_reopen()
+{
+	if (!ring.thread) {
+		_reopen(FALSE);
+		return;
+	}
+	g_atomic_int_set(&ring.reopen, 1);
+	_kick();
+}
+
+void
+log_shutdown()
+{
+	if (!ring.thread)
+		return;
+	g_atomic_int_set(&ring.running, 0);
+	_kick();
+	g_thread_join(ring.thread);
+	ring.thread = NULL;
+}
+
+void
+log_write(const gchar *domain, GLogLevelFlags level, const gchar *message)
+{
+	log_record_t *record;
+	gint pos, seq;
+	gsize len;
+
+	if (!domain)
+		domain = "";
+	if (!g_atomic_int_get(&ring.running) || level & G_LOG_LEVEL_ERROR) {
+		_write_direct(domain, level, message);
+		return;
+	}
+
+	/* claim a slot... the one at head is ours if its sequence
+	 * says so, lagging behind means the ring is full */
+	for (;;) {
+		pos = g_atomic_int_get(&ring.head);
+		record = &ring.records[pos & LOG_RING_MASK];
+		seq = g_atomic_int_get(&record->seq);
+		if (seq == pos) {
+			if (g_atomic_int_compare_and_exchange(&ring.head, pos, pos + 1))
+				break;
+		}
+		else if ((gint) ((guint) seq - (guint) pos) < 0) {
+			g_atomic_int_inc(&ring.dropped);
+			_kick();
+			return;
+		}
+	}
+
+	record->time = g_get_real_time();
+	record->level = level;
+	g_strlcpy(record->domain, domain, LOG_DOMAIN_MAX);
+	len = strlen(message);
+	if (len >= LOG_RECORD_MAX)
+		len = LOG_RECORD_MAX - 1;
+	memcpy(record->text, message, len);
+	record->len = len;
+	g_atomic_int_set(&record->seq, pos + 1);
+
+	if (level & LOG_URGENT ||
+			pos + 1 - g_atomic_int_get(&ring.tail) >= LOG_RING_SIZE / 2) {
+		_kick();
+	}
+}
+
+/* gets everything logged so far onto the disk without waiting for it */
+void
+log_flush()
+{
+	if (!ring.thread)
+		return;
+	g_atomic_int_set(&ring.sync, 1);
+	_kick();
+}
+
+/* formats and logs a message that passed the level check already...
+ * the line is tagged with the domain that selected the level */
+void
+log_printf(enum LogDomain domain, GLogLevelFlags level,
+	   const gchar *format, ...)
+{
+	char message[LOG_RECORD_MAX];
+	va_list args;
+
+	va_start(args, format);
+	/* without a logfile GLib's default handler has to do */
+	if (ring.fd < 0) {
+		g_logv(domain_names[domain], level, format, args);
+		va_end(args);
+		return;
+	}
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	log_write(domain_names[domain], level, message);
+}
+
+const char *
+log_domain_name(enum LogDomain domain)
+{
+	g_return_val_if_fail(domain < LOG_DOMAIN_COUNT, NULL);
+	return domain_names[domain];
+}
+
+/* the levels enabled for a configured log level... the
+ * given one and everything more severe */
+GLogLevelFlags
+log_parse_level(const char *level)
+{
+	GLogLevelFlags flags = G_LOG_FLAG_FATAL;
+
+	if (!strcmp(level, "DEBUG")) {
+		flags |= G_LOG_LEVEL_MASK;
+	}
+	else if (!strcmp(level, "INFO")) {
+		flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG);
+	}
+	else if (!strcmp(level, "MESSAGE")) {
+		flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
+			| G_LOG_LEVEL_INFO);
+	}
+	else if (!strcmp(level, "WARNING")) {
+		flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
+			| G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE);
+	}
+	else if (!strcmp(level, "CRITICAL")) {
+		flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
+			| G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE
+			| G_LOG_LEVEL_WARNING);
+	}
+	else if (!strcmp(level, "ERROR")) {
+		flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
+			| G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE
+			| G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL);
+	}
+	return flags;
+}
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_LOG_H
+#define _PHONEFSOD_LOG_H
+
+#include <glib.h>
+
+/* log levels can be set per part of phonefsod */
+enum LogDomain {
+	LOG_DOMAIN_MAIN,	/* daemon, config and startup */
+	LOG_DOMAIN_FSO,		/* everything driven by FSO */
+	LOG_DOMAIN_CALLS,	/* call tracking and caller ids */
+	LOG_DOMAIN_DBUS,	/* our interfaces and phoneuid */
+	LOG_DOMAIN_COUNT
+};
+
+/* each source file logs to one domain... set before including this */
+#ifndef PHONEFSOD_LOG_DOMAIN
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_MAIN
+#endif
+
+/* levels enabled per domain */
+extern GLogLevelFlags log_levels[LOG_DOMAIN_COUNT];
+
+/* the level is checked before anything gets formatted... a
+ * disabled statement costs a single branch */
+#define log_enabled(level) \
+	G_UNLIKELY(log_levels[PHONEFSOD_LOG_DOMAIN] & (level))
+
+#define log_debug(...) G_STMT_START { \
+	if (log_enabled(G_LOG_LEVEL_DEBUG)) \
+		log_printf(PHONEFSOD_LOG_DOMAIN, G_LOG_LEVEL_DEBUG, __VA_ARGS__); \
+} G_STMT_END
+
+#define log_info(...) G_STMT_START { \
+	if (log_enabled(G_LOG_LEVEL_INFO)) \
+		log_printf(PHONEFSOD_LOG_DOMAIN, G_LOG_LEVEL_INFO, __VA_ARGS__); \
+} G_STMT_END
+
+gboolean log_init(const char *path, gsize max_size, int max_files);
+void log_reopen();
+void log_shutdown();
+void log_write(const gchar *domain, GLogLevelFlags level, const gchar *message);
+void log_flush();
+void log_printf(enum LogDomain domain, GLogLevelFlags level,
+		const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+const char *log_domain_name(enum LogDomain domain);
+GLogLevelFlags log_parse_level(const char *level);
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#include <unistd.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <glib.h>
+#include "phonefsod-ready.h"
+
+/* write end of the pipe to the waiting parent process (-1 if none) */
+static int ready_fd = -1;
+static guint ready_conditions = 0;
+static gboolean ready_sent = FALSE;
+
+static void _notify_parent(void);
+static void _notify_supervisor(const char *state);
+
+void
+phonefsod_ready_init(int fd)
+{
+	ready_fd = fd;
+}
+
+void
+phonefsod_ready_set(guint conditions)
+{
+	ready_conditions |= conditions;
+	if (ready_sent || (ready_conditions & READY_ALL) != READY_ALL)
+		return;
+
+	ready_sent = TRUE;
+	g_message("phonefsod is ready");
+	_notify_parent();
+	_notify_supervisor("READY=1");
+}
+
+static void
+_notify_parent(void)
+{
+	ssize_t len;
+
+	if (ready_fd < 0)
+		return;
+
+	do {
+		len = write(ready_fd, "R", 1);
+	} while (len < 0 && errno == EINTR);
+	if (len != 1) {
+		g_warning("failed notifying parent of readiness: %s",
+			  g_strerror(errno));
+	}
+	close(ready_fd);
+	ready_fd = -1;
+}
+
+/* sd_notify(3) compatible notification of a supervisor */
+static void
+_notify_supervisor(const char *state)
+{
+	const char *path;
+	struct sockaddr_un sa;
+	socklen_t sa_len;
+	int fd;
+
+	path = g_getenv("NOTIFY_SOCKET");
+	if (!path || (path[0] != '/' && path[0] != '@') ||
+			strlen(path) >= sizeof(sa.sun_path)) {
+		return;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+	/* a leading @ denotes the abstract namespace */
+	if (sa.sun_path[0] == '@')
+		sa.sun_path[0] = '\0';
+	sa_len = offsetof(struct sockaddr_un, sun_path) + strlen(path);
+
+	fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		g_warning("failed creating notify socket: %s",
+			  g_strerror(errno));
+		return;
+	}
+	if (sendto(fd, state, strlen(state), MSG_NOSIGNAL,
+		   (struct sockaddr *)&sa, sa_len) < 0) {
+		g_warning("failed notifying %s: %s", path, g_strerror(errno));
+	}
+	close(fd);
+}
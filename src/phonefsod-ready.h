@@ -0,0 +1,32 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_READY_H
+#define _PHONEFSOD_READY_H
+
+#include <glib.h>
+
+/* conditions that have to be met before we are usable */
+enum PhonefsodReadyCondition {
+	READY_BUS_NAME = 1,	/* org.shr.phonefso is owned */
+	READY_FSO = 2,		/* fso_init() finished connecting */
+	READY_ALL = READY_BUS_NAME | READY_FSO
+};
+
+void phonefsod_ready_init(int fd);
+void phonefsod_ready_set(guint conditions);
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+/*
+ * Renders a flight recorder dump of phonefsod readable.
+ *
+ *   phonefsod-recorder-decode [dumpfile]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "phonefsod-recorder.h"
+
+static const char *event_names[REC_EVENT_COUNT] = {
+	[REC_NONE] = "none",
+	[REC_MILESTONE] = "milestone",
+	[REC_SERVICE] = "service",
+	[REC_RESOURCE] = "resource",
+	[REC_SYSTEM_ACTION] = "system-action",
+	[REC_IDLE_STATE] = "idle-state",
+	[REC_INPUT] = "input",
+	[REC_POWER_STATUS] = "power-status",
+	[REC_DEVICE_STATUS] = "device-status",
+	[REC_NETWORK_STATUS] = "network-status",
+	[REC_INCOMING_MESSAGE] = "incoming-message",
+	[REC_USSD] = "ussd",
+	[REC_CALL_STATUS] = "call-status",
+	[REC_CALL_STATE] = "call-state",
+	[REC_REQUEST] = "request",
+	[REC_REPLY] = "reply",
+	[REC_SUSPEND] = "suspend",
+	[REC_WAKE] = "wake",
+	[REC_BRIGHTNESS] = "brightness",
+};
+
+static const char *service_names[] = {
+	[REC_SERVICE_USAGE] = "ousaged",
+	[REC_SERVICE_GSM] = "ogsmd",
+	[REC_SERVICE_DEVICE] = "odeviced",
+};
+
+static const char *resource_names[] = {
+	[REC_RESOURCE_OTHER] = "other",
+	[REC_RESOURCE_GSM] = "GSM",
+	[REC_RESOURCE_DISPLAY] = "Display",
+	[REC_RESOURCE_CPU] = "CPU",
+};
+
+static const char *request_names[REC_REQUEST_COUNT] = {
+	[REC_REQUEST_LIST_RESOURCES] = "ListResources",
+	[REC_REQUEST_GSM] = "RequestResource(GSM)",
+	[REC_REQUEST_SET_FUNCTIONALITY] = "SetFunctionality",
+	[REC_REQUEST_SIM_INFO] = "GetSimInfo",
+	[REC_REQUEST_REGISTER] = "Register",
+	[REC_REQUEST_SUSPEND] = "Suspend",
+};
+
+#define NAME(table, i) \
+	((i) >= 0 && (size_t) (i) < sizeof(table) / sizeof(table[0]) && \
+	 table[i] ? table[i] : "?")
+
+static void
+_print_args(const recorder_record_t *record)
+{
+	switch (record->event) {
+	case REC_SERVICE:
+		printf("%s %s", NAME(service_names, record->a),
+		       record->b ? "up" : "down");
+		break;
+	case REC_RESOURCE:
+		printf("%s %s", NAME(resource_names, record->a),
+		       record->b ? "enabled" : "disabled");
+		break;
+	case REC_REQUEST:
+		printf("%s arg=%d", NAME(request_names, record->a), record->b);
+		break;
+	case REC_REPLY:
+		printf("%s error=%d", NAME(request_names, record->a), record->b);
+		break;
+	case REC_CALL_STATUS:
+	case REC_CALL_STATE:
+		printf("call=%d state=%d", record->a, record->b);
+		break;
+	case REC_SUSPEND:
+		printf("eligible=%d latency=%dms", record->a, record->b);
+		break;
+	case REC_WAKE:
+		printf("cause=%d suspended=%ds", record->a, record->b);
+		break;
+	case REC_INPUT:
+		printf("state=%d duration=%d", record->a, record->b);
+		break;
+	case REC_INCOMING_MESSAGE:
+		break;
+	default:
+		printf("%d", record->a);
+		break;
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : RECORDER_DUMP_FILE;
+	recorder_header_t header;
+	recorder_record_t record;
+	char date[30];
+	struct tm ptime;
+	time_t sec;
+	guint32 i;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+			memcmp(header.magic, RECORDER_MAGIC, sizeof(header.magic))) {
+		fprintf(stderr, "%s: not a phonefsod flight recorder dump\n", path);
+		fclose(f);
+		return 1;
+	}
+	if (header.version != RECORDER_VERSION) {
+		fprintf(stderr, "%s: unsupported version %u\n", path,
+			header.version);
+		fclose(f);
+		return 1;
+	}
+
+	sec = header.realtime / G_USEC_PER_SEC;
+	localtime_r(&sec, &ptime);
+	strftime(date, sizeof(date), "%Y.%m.%d %T", &ptime);
+	printf("# %u records, dumped %s\n", header.count, date);
+
+	for (i = 0; i < header.count; i++) {
+		gint64 realtime;
+		if (fread(&record, sizeof(record), 1, f) != 1) {
+			fprintf(stderr, "%s: truncated after %u records\n",
+				path, i);
+			break;
+		}
+		/* the records carry CLOCK_BOOTTIME... place them
+		 * relative to the wall clock of the dump */
+		realtime = header.realtime - (header.boottime - record.time);
+		sec = realtime / G_USEC_PER_SEC;
+		localtime_r(&sec, &ptime);
+		strftime(date, sizeof(date), "%Y.%m.%d %T", &ptime);
+		printf("%s.%06d %-16s ", date,
+		       (int) (realtime % G_USEC_PER_SEC),
+		       record.event < REC_EVENT_COUNT ?
+		       event_names[record.event] : "?");
+		_print_args(&record);
+		printf("\n");
+	}
+
+	fclose(f);
+	return 0;
+}
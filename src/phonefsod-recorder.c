@@ -0,0 +1,173 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+/*
+ * Flight recorder: a fixed ring of compact binary records of what
+ * happened lately, always on and cheap enough for the hot paths -
+ * recording is a timestamp and three integers, nothing gets
+ * formatted. It is dumped to a file on SIGUSR1, on a crash or via
+ * D-Bus and rendered with phonefsod-recorder-decode.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <glib.h>
+#include "phonefsod-recorder.h"
+
+#ifndef CLOCK_BOOTTIME
+#define CLOCK_BOOTTIME 7
+#endif
+
+#define RECORDER_MASK (RECORDER_SIZE - 1)
+
+static recorder_record_t records[RECORDER_SIZE];
+static volatile guint head = 0;
+/* a buffer of its own as the crash handler must not allocate */
+static char dump_file[PATH_MAX] = RECORDER_DUMP_FILE;
+
+static const int crash_signals[] = {
+	SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT
+};
+
+
+static gint64
+_clock_us(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+/* the records carry CLOCK_BOOTTIME as CLOCK_MONOTONIC stops while
+ * suspended and would squash the time around a suspend together */
+void
+recorder_add(enum RecorderEvent event, gint32 a, gint32 b)
+{
+	recorder_record_t *record = &records[head++ & RECORDER_MASK];
+
+	record->time = _clock_us(CLOCK_BOOTTIME);
+	record->event = event;
+	record->a = a;
+	record->b = b;
+}
+
+/* the recorder is dumped into the directory of the logfile */
+void
+recorder_set_log_file(const char *logpath)
+{
+	gchar *dir = g_path_get_dirname(logpath);
+	gchar *path = g_build_filename(dir, RECORDER_DUMP_NAME, NULL);
+
+	g_strlcpy(dump_file, path, sizeof(dump_file));
+	g_free(path);
+	g_free(dir);
+}
+
+const char *
+recorder_dump_file()
+{
+	return dump_file;
+}
+
+static gboolean
+_write_all(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+
+	while (len > 0) {
+		ssize_t written = write(fd, p, len);
+		if (written < 0)
+			return FALSE;
+		p += written;
+		len -= written;
+	}
+	return TRUE;
+}
+
+/* only uses async-signal-safe calls as it is run from the crash handler */
+gboolean
+recorder_dump(const char *path)
+{
+	recorder_header_t header;
+	guint end = head;
+	guint count, first;
+	gboolean ok;
+	int fd;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return FALSE;
+
+	count = end < RECORDER_SIZE ? end : RECORDER_SIZE;
+	first = (end - count) & RECORDER_MASK;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORDER_MAGIC, sizeof(header.magic));
+	header.version = RECORDER_VERSION;
+	header.count = count;
+	header.boottime = _clock_us(CLOCK_BOOTTIME);
+	header.realtime = _clock_us(CLOCK_REALTIME);
+
+	/* the ring wraps... write the older part first */
+	ok = _write_all(fd, &header, sizeof(header));
+	if (ok && first + count > RECORDER_SIZE) {
+		ok = _write_all(fd, &records[first],
+				(RECORDER_SIZE - first) * sizeof(recorder_record_t)) &&
+			_write_all(fd, &records[0],
+				(first + count - RECORDER_SIZE) * sizeof(recorder_record_t));
+	}
+	else if (ok) {
+		ok = _write_all(fd, &records[first],
+				count * sizeof(recorder_record_t));
+	}
+	close(fd);
+	return ok;
+}
+
+static void
+_crash_handler(int sig)
+{
+	recorder_dump(dump_file);
+	/* the handler was reset... let the default action happen */
+	raise(sig);
+}
+
+/* dumps the recorder when we crash... the signals are unblocked for
+ * the calling thread as they are not handled by the signal thread */
+void
+recorder_install_crash_handler()
+{
+	struct sigaction action;
+	sigset_t crash_set;
+	guint i;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = _crash_handler;
+	action.sa_flags = SA_RESETHAND;
+	sigemptyset(&action.sa_mask);
+	sigemptyset(&crash_set);
+
+	for (i = 0; i < G_N_ELEMENTS(crash_signals); i++) {
+		sigaction(crash_signals[i], &action, NULL);
+		sigaddset(&crash_set, crash_signals[i]);
+	}
+	pthread_sigmask(SIG_UNBLOCK, &crash_set, NULL);
+}
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_RECORDER_H
+#define _PHONEFSOD_RECORDER_H
+
+#include <glib.h>
+
+/* must be a power of 2 */
+#define RECORDER_SIZE 4096
+/* dumped next to the logfile, this is where the default one is */
+#define RECORDER_DUMP_NAME "phonefsod.rec"
+#define RECORDER_DUMP_FILE "/var/log/" RECORDER_DUMP_NAME
+#define RECORDER_MAGIC "PFSDREC1"
+#define RECORDER_VERSION 1
+
+enum RecorderEvent {
+	REC_NONE,
+	REC_MILESTONE,		/* a: StartupMilestone */
+	REC_SERVICE,		/* a: RecorderService, b: on the bus */
+	REC_RESOURCE,		/* a: RecorderResource, b: enabled */
+	REC_SYSTEM_ACTION,	/* a: FreeSmartphoneUsageSystemAction */
+	REC_IDLE_STATE,		/* a: FreeSmartphoneDeviceIdleState */
+	REC_INPUT,		/* a: FreeSmartphoneDeviceInputState, b: duration */
+	REC_POWER_STATUS,	/* a: FreeSmartphoneDevicePowerStatus */
+	REC_DEVICE_STATUS,	/* a: FreeSmartphoneGSMDeviceStatus */
+	REC_NETWORK_STATUS,	/* a: registered */
+	REC_INCOMING_MESSAGE,
+	REC_USSD,		/* a: mode */
+	REC_CALL_STATUS,	/* a: call id, b: FreeSmartphoneGSMCallStatus */
+	REC_CALL_STATE,		/* a: call id, b: CallState */
+	REC_REQUEST,		/* a: RecorderRequest, b: argument */
+	REC_REPLY,		/* a: RecorderRequest, b: error code or 0 */
+	REC_SUSPEND,		/* a: eligible, b: latency ms */
+	REC_WAKE,		/* a: WakeCause, b: seconds suspended */
+	REC_BRIGHTNESS,		/* a: level written */
+	REC_EVENT_COUNT
+};
+
+enum RecorderService {
+	REC_SERVICE_USAGE,
+	REC_SERVICE_GSM,
+	REC_SERVICE_DEVICE
+};
+
+enum RecorderResource {
+	REC_RESOURCE_OTHER,
+	REC_RESOURCE_GSM,
+	REC_RESOURCE_DISPLAY,
+	REC_RESOURCE_CPU
+};
+
+enum RecorderRequest {
+	REC_REQUEST_LIST_RESOURCES,
+	REC_REQUEST_GSM,
+	REC_REQUEST_SET_FUNCTIONALITY,
+	REC_REQUEST_SIM_INFO,
+	REC_REQUEST_REGISTER,
+	REC_REQUEST_SUSPEND,
+	REC_REQUEST_COUNT
+};
+
+/* the dump is the header followed by the records oldest first,
+ * all in host byte order */
+typedef struct {
+	char magic[8];
+	guint32 version;
+	guint32 count;
+	gint64 boottime;	/* us when dumped */
+	gint64 realtime;	/* us when dumped */
+} recorder_header_t;
+
+typedef struct {
+	gint64 time;		/* CLOCK_BOOTTIME us */
+	guint32 event;
+	gint32 a;
+	gint32 b;
+	guint32 reserved;
+} recorder_record_t;
+
+void recorder_add(enum RecorderEvent event, gint32 a, gint32 b);
+void recorder_set_log_file(const char *logpath);
+const char *recorder_dump_file();
+gboolean recorder_dump(const char *path);
+void recorder_install_crash_handler();
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#include <glib.h>
+#include "phonefsod-retry.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_FSO
+#include "phonefsod-log.h"
+
+/* all operations that ever retried - for the statistics */
+static GSList *retries = NULL;
+
+static gboolean _retry_fire(gpointer data);
+
+void
+retry_schedule(retry_t *retry)
+{
+	guint delay;
+
+	if (!retry->registered) {
+		retries = g_slist_append(retries, retry);
+		retry->registered = TRUE;
+	}
+
+	if (retry->source_id) {
+		log_debug("retry of %s already pending", retry->name);
+		return;
+	}
+
+	/* exponential backoff up to the ceiling... then take a random
+	 * part of up to half of it away so that retries of several
+	 * daemons waiting on the same thing spread out */
+	delay = retry->base;
+	if (retry->failures < 16)
+		delay <<= retry->failures;
+	else
+		delay = retry->ceiling;
+	if (delay > retry->ceiling)
+		delay = retry->ceiling;
+	delay -= g_random_int_range(0, delay / 2 + 1);
+	if (delay < 1)
+		delay = 1;
+
+	retry->failures++;
+	retry->total++;
+	retry->delay = delay;
+	log_debug("retrying %s in %us (attempt %u)", retry->name, delay,
+		retry->failures);
+
+	/* full seconds only, so the wakeups coalesce with others */
+	retry->source_id = g_timeout_add_seconds(delay, _retry_fire, retry);
+}
+
+void
+retry_reset(retry_t *retry)
+{
+	if (retry->failures)
+		log_debug("%s succeeded after %u retries", retry->name,
+			retry->failures);
+	retry_cancel(retry);
+	retry->failures = 0;
+}
+
+void
+retry_cancel(retry_t *retry)
+{
+	if (retry->source_id) {
+		g_source_remove(retry->source_id);
+		retry->source_id = 0;
+	}
+	retry->delay = 0;
+}
+
+/* a(suuu) of name, consecutive failures, total retries
+ * and the delay of the pending retry (0 if none) */
+GVariant *
+retry_to_variant(void)
+{
+	GVariantBuilder builder;
+	GSList *l;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(suuu)"));
+	for (l = retries; l; l = l->next) {
+		retry_t *retry = l->data;
+		g_variant_builder_add(&builder, "(suuu)", retry->name,
+				      retry->failures, retry->total,
+				      retry->source_id ? retry->delay : 0);
+	}
+
+	return g_variant_builder_end(&builder);
+}
+
+static gboolean
+_retry_fire(gpointer data)
+{
+	retry_t *retry = data;
+
+	retry->source_id = 0;
+	retry->delay = 0;
+	retry->func(NULL);
+
+	return FALSE;
+}
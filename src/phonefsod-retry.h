@@ -0,0 +1,44 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_RETRY_H
+#define _PHONEFSOD_RETRY_H
+
+#include <glib.h>
+
+/* state of one retried operation... delays are in seconds and
+ * double with every failure (with jitter) up to the ceiling */
+typedef struct {
+	const char *name;
+	guint base;
+	guint ceiling;
+	GSourceFunc func;
+	guint failures;		/* consecutive, reset on success */
+	guint total;		/* all retries ever scheduled */
+	guint delay;		/* delay of the pending retry */
+	guint source_id;
+	gboolean registered;
+} retry_t;
+
+#define RETRY_INIT(name, base, ceiling, func) \
+	{ name, base, ceiling, func, 0, 0, 0, 0, FALSE }
+
+void retry_schedule(retry_t *retry);
+void retry_reset(retry_t *retry);
+void retry_cancel(retry_t *retry);
+GVariant *retry_to_variant(void);
+
+#endif
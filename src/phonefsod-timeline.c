@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#include <glib.h>
+#include "phonefsod-timeline.h"
+#include "phonefsod-recorder.h"
+
+static const char *milestone_names[MILESTONE_COUNT] = {
+	[MILESTONE_PROCESS_START] = "process-start",
+	[MILESTONE_BUS_ACQUIRED] = "bus-acquired",
+	[MILESTONE_FSO_CONNECTED] = "fso-connected",
+	[MILESTONE_RESOURCES_LISTED] = "resources-listed",
+	[MILESTONE_GSM_REQUESTED] = "gsm-requested",
+	[MILESTONE_GSM_GRANTED] = "gsm-granted",
+	[MILESTONE_SIM_LOCKED] = "sim-locked",
+	[MILESTONE_SIM_READY] = "sim-ready",
+	[MILESTONE_REGISTERED] = "registered",
+	[MILESTONE_FUNCTIONALITY_SET] = "functionality-set",
+};
+
+/* CLOCK_MONOTONIC timestamps in us - 0 means not yet reached */
+static gint64 milestones[MILESTONE_COUNT];
+static gboolean summary_logged = FALSE;
+
+void
+timeline_mark(enum StartupMilestone milestone)
+{
+	g_return_if_fail(milestone < MILESTONE_COUNT);
+
+	/* only the first occurence counts for the bring-up */
+	if (milestones[milestone])
+		return;
+
+	milestones[milestone] = g_get_monotonic_time();
+	recorder_add(REC_MILESTONE, milestone, 0);
+	g_debug("startup milestone %s reached after %" G_GINT64_FORMAT "ms",
+		milestone_names[milestone],
+		(milestones[milestone] - milestones[MILESTONE_PROCESS_START]) / 1000);
+}
+
+void
+timeline_log_summary(void)
+{
+	GString *line;
+	int i;
+
+	if (summary_logged)
+		return;
+	summary_logged = TRUE;
+
+	line = g_string_new("Startup timeline:");
+	for (i = MILESTONE_PROCESS_START + 1; i < MILESTONE_COUNT; i++) {
+		if (!milestones[i])
+			continue;
+		g_string_append_printf(line, " %s=+%" G_GINT64_FORMAT "ms",
+			milestone_names[i],
+			(milestones[i] - milestones[MILESTONE_PROCESS_START]) / 1000);
+	}
+	g_message("%s", line->str);
+	g_string_free(line, TRUE);
+}
+
+/* a(sx) of milestone name and us since process start... only
+ * milestones that were actually reached are included */
+GVariant *
+timeline_to_variant(void)
+{
+	GVariantBuilder builder;
+	int i;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sx)"));
+	for (i = 0; i < MILESTONE_COUNT; i++) {
+		if (!milestones[i])
+			continue;
+		g_variant_builder_add(&builder, "(sx)", milestone_names[i],
+			milestones[i] - milestones[MILESTONE_PROCESS_START]);
+	}
+
+	return g_variant_builder_end(&builder);
+}
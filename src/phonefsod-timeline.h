@@ -0,0 +1,41 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_TIMELINE_H
+#define _PHONEFSOD_TIMELINE_H
+
+#include <glib.h>
+
+/* bring-up milestones in the order they are expected to happen */
+enum StartupMilestone {
+	MILESTONE_PROCESS_START = 0,
+	MILESTONE_BUS_ACQUIRED,
+	MILESTONE_FSO_CONNECTED,
+	MILESTONE_RESOURCES_LISTED,
+	MILESTONE_GSM_REQUESTED,
+	MILESTONE_GSM_GRANTED,
+	MILESTONE_SIM_LOCKED,
+	MILESTONE_SIM_READY,
+	MILESTONE_REGISTERED,
+	MILESTONE_FUNCTIONALITY_SET,
+	MILESTONE_COUNT
+};
+
+void timeline_mark(enum StartupMilestone milestone);
+void timeline_log_summary(void);
+GVariant *timeline_to_variant(void);
+
+#endif
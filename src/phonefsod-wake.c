@@ -0,0 +1,298 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+/*
+ * Accounting of suspend/resume cycles: how long the device was
+ * suspended and what woke it up. The cause is taken from the first
+ * signal we get after resume - or while still suspending, as the
+ * signal that woke us might beat the resume system action. Signals
+ * between the suspend system action and the kernel actually going
+ * to sleep are not taken: CLOCK_BOOTTIME and CLOCK_MONOTONIC only
+ * drift apart once the kernel has been suspended.
+ *
+ * The kernel wakeup_count is read in a thread of its own, as the
+ * read sleeps while wakeup events are being processed - which is
+ * just what happens around suspend and resume.
+ */
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <glib.h>
+#include "phonefsod-wake.h"
+#include "phonefsod-histogram.h"
+#include "phonefsod-recorder.h"
+#define PHONEFSOD_LOG_DOMAIN LOG_DOMAIN_FSO
+#include "phonefsod-log.h"
+
+#ifndef CLOCK_BOOTTIME
+#define CLOCK_BOOTTIME 7
+#endif
+
+#define WAKEUP_COUNT_FILE "/sys/power/wakeup_count"
+/* a resume without any signal within this time has an unknown cause */
+#define WAKE_CAUSE_TIMEOUT 5
+/* us CLOCK_BOOTTIME has to be ahead of CLOCK_MONOTONIC for us to
+ * have been suspended... more than the two clocks ever differ by */
+#define WAKE_SLEPT_MIN 1000
+
+enum WakeState {
+	WAKE_STATE_AWAKE,
+	WAKE_STATE_SUSPENDED,
+	WAKE_STATE_RESUMED
+};
+
+static const char *cause_names[WAKE_CAUSE_COUNT] = {
+	[WAKE_CAUSE_UNKNOWN] = "unknown",
+	[WAKE_CAUSE_CALL] = "call",
+	[WAKE_CAUSE_SMS] = "sms",
+	[WAKE_CAUSE_USSD] = "ussd",
+	[WAKE_CAUSE_INPUT] = "input",
+	[WAKE_CAUSE_NETWORK] = "network",
+};
+
+static struct {
+	enum WakeState state;
+	enum WakeCause cause;		/* of the current cycle */
+	gint64 suspended_at;		/* CLOCK_BOOTTIME us */
+	gint64 suspended_mono;		/* CLOCK_MONOTONIC us */
+	guint sample;			/* wakeup_count reads of this cycle... */
+	gint64 count_before;		/* ...kernel wakeup events, -1 unknown */
+	gint64 count_after;
+	guint timeout_id;
+	guint cycles;
+	guint counts[WAKE_CAUSE_COUNT];
+	gint64 wakeup_events;		/* summed over all cycles */
+	gint64 last_duration;		/* us */
+	enum WakeCause last_cause;
+} wake = { WAKE_STATE_AWAKE, WAKE_CAUSE_UNKNOWN, 0, 0, 0, -1, -1, 0, 0,
+	   { 0 }, 0, 0, WAKE_CAUSE_UNKNOWN };
+
+/* one wakeup_count read handed to its thread and back */
+typedef struct {
+	guint sample;
+	gboolean after;
+	gint64 count;
+} wakeup_sample_t;
+
+static histogram_t suspend_duration = HISTOGRAM_INIT("suspend-duration");
+
+
+/* CLOCK_MONOTONIC stops while suspended, CLOCK_BOOTTIME does not */
+static gint64
+_boottime()
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_BOOTTIME, &ts) < 0)
+		return g_get_monotonic_time();
+	return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static gint64
+_read_wakeup_count()
+{
+	char buf[32];
+	ssize_t len;
+	int fd;
+
+	fd = open(WAKEUP_COUNT_FILE, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+	return g_ascii_strtoll(buf, NULL, 10);
+}
+
+/* back in the main loop... the events are added once both reads of
+ * the cycle are there, whichever finished first */
+static gboolean
+_wakeup_count_done(gpointer data)
+{
+	wakeup_sample_t *sample = data;
+
+	/* a read of an earlier cycle that took its time */
+	if (sample->sample != wake.sample) {
+		g_free(sample);
+		return FALSE;
+	}
+	if (sample->after)
+		wake.count_after = sample->count;
+	else
+		wake.count_before = sample->count;
+	g_free(sample);
+
+	if (wake.count_before < 0 || wake.count_after < 0)
+		return FALSE;
+	if (wake.count_after > wake.count_before) {
+		log_debug("%lld kernel wakeup events while suspended",
+			(long long) (wake.count_after - wake.count_before));
+		wake.wakeup_events += wake.count_after - wake.count_before;
+	}
+	wake.count_before = wake.count_after = -1;
+	return FALSE;
+}
+
+static gpointer
+_wakeup_count_thread(gpointer data)
+{
+	wakeup_sample_t *sample = data;
+
+	sample->count = _read_wakeup_count();
+	g_idle_add(_wakeup_count_done, sample);
+	return NULL;
+}
+
+static void
+_wakeup_count_sample(gboolean after)
+{
+	wakeup_sample_t *sample = g_new0(wakeup_sample_t, 1);
+	GError *error = NULL;
+
+	sample->sample = wake.sample;
+	sample->after = after;
+	if (!g_thread_create(_wakeup_count_thread, sample, FALSE, &error)) {
+		log_debug("no thread for reading wakeup_count: %s",
+			  error->message);
+		g_error_free(error);
+		g_free(sample);
+	}
+}
+
+/* whether the kernel was suspended since the suspend system action */
+static gboolean
+_slept()
+{
+	return (_boottime() - wake.suspended_at) -
+		(g_get_monotonic_time() - wake.suspended_mono) > WAKE_SLEPT_MIN;
+}
+
+static void
+_cycle_done(enum WakeCause cause)
+{
+	if (wake.timeout_id) {
+		g_source_remove(wake.timeout_id);
+		wake.timeout_id = 0;
+	}
+	wake.state = WAKE_STATE_AWAKE;
+	wake.last_cause = cause;
+	wake.counts[cause]++;
+	recorder_add(REC_WAKE, cause, wake.last_duration / G_USEC_PER_SEC);
+	g_message("Woken up by %s after %lld s suspended", cause_names[cause],
+		  (long long) (wake.last_duration / G_USEC_PER_SEC));
+}
+
+static gboolean
+_cause_timeout(gpointer data)
+{
+	(void) data;
+	wake.timeout_id = 0;
+	_cycle_done(WAKE_CAUSE_UNKNOWN);
+	return FALSE;
+}
+
+void
+wake_suspending()
+{
+	/* a cycle still waiting for its cause never got one */
+	if (wake.state == WAKE_STATE_RESUMED)
+		_cycle_done(WAKE_CAUSE_UNKNOWN);
+
+	wake.state = WAKE_STATE_SUSPENDED;
+	wake.cause = WAKE_CAUSE_UNKNOWN;
+	wake.suspended_at = _boottime();
+	wake.suspended_mono = g_get_monotonic_time();
+	wake.sample++;
+	wake.count_before = wake.count_after = -1;
+	_wakeup_count_sample(FALSE);
+}
+
+void
+wake_resumed()
+{
+	if (wake.state != WAKE_STATE_SUSPENDED) {
+		log_debug("resumed without having seen the suspend");
+		return;
+	}
+
+	wake.cycles++;
+	wake.last_duration = _boottime() - wake.suspended_at;
+	histogram_add(&suspend_duration, wake.last_duration);
+
+	_wakeup_count_sample(TRUE);
+
+	if (wake.cause != WAKE_CAUSE_UNKNOWN) {
+		_cycle_done(wake.cause);
+		return;
+	}
+	wake.state = WAKE_STATE_RESUMED;
+	wake.timeout_id = g_timeout_add_seconds(WAKE_CAUSE_TIMEOUT,
+						_cause_timeout, NULL);
+}
+
+void
+wake_signal(enum WakeCause cause)
+{
+	g_return_if_fail(cause < WAKE_CAUSE_COUNT);
+
+	switch (wake.state) {
+	case WAKE_STATE_SUSPENDED:
+		/* before the kernel went to sleep it cannot have woken us */
+		if (wake.cause == WAKE_CAUSE_UNKNOWN && _slept())
+			wake.cause = cause;
+		break;
+	case WAKE_STATE_RESUMED:
+		_cycle_done(cause);
+		break;
+	default:
+		break;
+	}
+}
+
+/* a{sx} with the number of cycles, kernel wakeup events, the last
+ * cycle and how often each cause woke us up */
+GVariant *
+wake_stats_to_variant()
+{
+	GVariantBuilder builder;
+	int i;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sx}"));
+	g_variant_builder_add(&builder, "{sx}", "cycles",
+			      (gint64) wake.cycles);
+	g_variant_builder_add(&builder, "{sx}", "wakeup-events",
+			      wake.wakeup_events);
+	g_variant_builder_add(&builder, "{sx}", "last-duration-ms",
+			      wake.last_duration / 1000);
+	for (i = 0; i < WAKE_CAUSE_COUNT; i++) {
+		char *key = g_strdup_printf("cause-%s", cause_names[i]);
+		g_variant_builder_add(&builder, "{sx}", key,
+				      (gint64) wake.counts[i]);
+		g_free(key);
+	}
+
+	return g_variant_builder_end(&builder);
+}
+
+/* (suxxxau) of the time spent suspended */
+GVariant *
+wake_duration_to_variant()
+{
+	return histogram_to_variant(&suspend_duration);
+}
@@ -0,0 +1,39 @@
+/*
+ *  Copyright (C) 2009-2012
+ *      Authors (alphabetical) :
+ *              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+ *              Lukas 'slyon' Märdian <luk@slyon.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Public License as published by
+ *  the Free Software Foundation; version 2 of the license or any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser Public License for more details.
+ */
+
+#ifndef _PHONEFSOD_WAKE_H
+#define _PHONEFSOD_WAKE_H
+
+#include <glib.h>
+
+/* what woke the device... the first signal after resume wins */
+enum WakeCause {
+	WAKE_CAUSE_UNKNOWN,
+	WAKE_CAUSE_CALL,
+	WAKE_CAUSE_SMS,
+	WAKE_CAUSE_USSD,
+	WAKE_CAUSE_INPUT,
+	WAKE_CAUSE_NETWORK,
+	WAKE_CAUSE_COUNT
+};
+
+void wake_suspending();
+void wake_resumed();
+void wake_signal(enum WakeCause cause);
+GVariant *wake_stats_to_variant();
+GVariant *wake_duration_to_variant();
+
+#endif
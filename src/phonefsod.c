@@ -24,12 +24,12 @@
 #include <sys/stat.h>   /* umask() */
 #include <fcntl.h>      /* open() */
 #include <errno.h>
-#include <unistd.h>     /* daemon(), sleep(), exit() */
+#include <unistd.h>     /* daemon(), pipe(), exit() */
 #include <signal.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <sys/inotify.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -38,6 +38,11 @@
 #include "phonefsod-dbus.h"
 #include "phonefsod-fso.h"
 #include "phonefsod-globals.h"
+#include "phonefsod-ready.h"
+#include "phonefsod-timeline.h"
+#include "phonefsod-log.h"
+#include "phonefsod-recorder.h"
+#include "phonefsod-config.h"
 
 
 /* Program Standards passed from compiler */
@@ -58,6 +63,9 @@
 // FIXME: ugly !!!
 #define LOGFILE "/var/log/phonefsod.log"
 #define DEFAULT_DEBUG_LEVEL "INFO"
+/* KiB per logfile and how many rotated ones to keep */
+#define DEFAULT_LOG_MAX_SIZE 512
+#define DEFAULT_LOG_MAX_FILES 2
 
 /* defines for config defaults */
 #define MINIMUM_GSM_REREGISTER_TIMEOUT 60
@@ -65,6 +73,11 @@
 #define DEFAULT_DEFAULT_BRIGHTNESS 100
 #define DEFAULT_MINIMUM_BRIGHTNESS 10
 
+/* ms to wait for the config file to settle before reloading it */
+#define CONFIG_RELOAD_DELAY 500
+/* s the parent waits for the daemon to become ready */
+#define DAEMON_READY_TIMEOUT 60
+
 /* global variable used to indicate that
  * program exit is desired 1=run, 0=exit */
 static volatile gint gd_flag_exit = 1;
@@ -84,11 +97,30 @@ static gboolean gd_b_force = FALSE;
 /* Version flag */
 static gboolean gd_b_version = FALSE;
 
-/* file stream for the logfile */
-static FILE *logfile = NULL;
-
-/* handle for notification on config changes */
-static int notify;
+/* notification on config changes */
+static GFileMonitor *config_monitor = NULL;
+static guint config_reload_id = 0;
+
+/* the pin as read from the config... SetPin does not save it */
+static char *config_pin = NULL;
+
+/* the settings a reload applies to the running daemon */
+typedef struct {
+	gboolean offline_mode;
+	FreeSmartphoneGSMCallingIdentificationStatus calling_identification;
+	char *pdp_apn;
+	char *pdp_user;
+	char *pdp_password;
+	char *sim_pin;
+	int default_brightness;
+	int minimum_brightness;
+	int dim_idle_percent;
+	int dim_idle_dim_percent;
+	int dim_idle_prelock_percent;
+	enum DimScreenMode dim_screen;
+	enum AutoSuspendMode auto_suspend;
+	int gsm_reregister_timeout;
+} config_snapshot_t;
 
 static GLogLevelFlags log_flags;
 
@@ -106,62 +138,33 @@ static void
 _log_handler(const gchar *domain, GLogLevelFlags level, const gchar *message,
 		gpointer userdata)
 {
-	char *levelstr;
-	char date_str[30];
-	struct timeval tv;
-	struct tm ptime;
 	if (!(log_flags & G_LOG_LEVEL_MASK & level)) {
 		return;
 	}
-	gettimeofday(&tv, NULL);
-	localtime_r(&tv.tv_sec, &ptime);
-
-	strftime(date_str, 30, "%Y.%m.%d %T", &ptime);
-
-	switch (level) {
-	case G_LOG_LEVEL_ERROR:
-		levelstr = "ERROR";
-		break;
-	case G_LOG_LEVEL_CRITICAL:
-		levelstr = "CRITICAL";
-		break;
-	case G_LOG_LEVEL_WARNING:
-		levelstr = "WARNING";
-		break;
-	case G_LOG_LEVEL_MESSAGE:
-		levelstr = "MESSAGE";
-		break;
-	case G_LOG_LEVEL_INFO:
-		levelstr = "INFO";
-		break;
-	case G_LOG_LEVEL_DEBUG:
-		levelstr = "DEBUG";
-		break;
-	default:
-		levelstr = "";
-		break;
-	}
-
-	fprintf(logfile, "%s.%06d [%s]\t%s: %s\n", date_str, (int) tv.tv_usec,
-			domain, levelstr, message);
-	fflush(logfile);
+	/* formatting and writing is done by the log thread */
+	log_write(domain, level, message);
 }
 
-static void
-_load_config()
+static gboolean
+_load_config(gboolean reload)
 {
+	gboolean loaded = FALSE;
 	GKeyFile *keyfile;
 	GKeyFileFlags flags;
 	GError *error = NULL;
 	char *debug_level = NULL;
+	char *domain_level[LOG_DOMAIN_COUNT] = { NULL };
 	char *logpath = NULL;
+	int log_max_size = DEFAULT_LOG_MAX_SIZE;
+	int log_max_files = DEFAULT_LOG_MAX_FILES;
 	char *s = NULL;
+	int i;
 
 	/* Read the phonefsod preferences */
 	keyfile = g_key_file_new();
 	flags = G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS;
 	if (g_key_file_load_from_file
-	    (keyfile, PHONEFSOD_CONFIG, flags, &error)) {
+	    (keyfile, config_file, flags, &error)) {
 
 		/* --- [logging] --- */
 		logpath = g_key_file_get_string(keyfile, "logging",
@@ -169,6 +172,37 @@ _load_config()
 		debug_level =
 			g_key_file_get_string(keyfile, "logging",
 					"log_level", NULL);
+		for (i = 0; i < LOG_DOMAIN_COUNT; i++) {
+			s = g_strdup_printf("log_level_%s",
+					log_domain_name(i));
+			domain_level[i] =
+				g_key_file_get_string(keyfile, "logging",
+						s, NULL);
+			g_free(s);
+		}
+		s = NULL;
+		log_max_size =
+			g_key_file_get_integer(keyfile, "logging",
+					"log_max_size", &error);
+		if (error) {
+			log_max_size = DEFAULT_LOG_MAX_SIZE;
+			g_error_free(error);
+			error = NULL;
+		}
+		else if (log_max_size < 0) {
+			log_max_size = DEFAULT_LOG_MAX_SIZE;
+		}
+		log_max_files =
+			g_key_file_get_integer(keyfile, "logging",
+					"log_max_files", &error);
+		if (error) {
+			log_max_files = DEFAULT_LOG_MAX_FILES;
+			g_error_free(error);
+			error = NULL;
+		}
+		else if (log_max_files < 0) {
+			log_max_files = DEFAULT_LOG_MAX_FILES;
+		}
 
 		/* --- [gsm] --- */
 		offline_mode =
@@ -189,6 +223,11 @@ _load_config()
 			g_error_free(error);
 			error = NULL;
 		}
+		/* a negative time would inhibit suspend forever */
+		else if (inhibit_suspend_on_startup_time < 0) {
+			g_message("invalid inhibit_suspend_on_startup_time - setting to 0s");
+			inhibit_suspend_on_startup_time = 0;
+		}
 
 		show_incoming_sms =
 			g_key_file_get_boolean(keyfile, "gsm",
@@ -232,10 +271,12 @@ _load_config()
 			}
 			else {
 				g_warning("Invalid value '%s' for calling_identification in [gsm] section of %s",
-					  s, PHONEFSOD_CONFIG);
+					  s, config_file);
 				g_message("Defaulting to network");
 				calling_identification = FREE_SMARTPHONE_GSM_CALLING_IDENTIFICATION_STATUS_NETWORK;
 			}
+			g_free(s);
+			s = NULL;
 		}
 
 		pdp_apn = g_key_file_get_string(keyfile, "gsm",
@@ -291,10 +332,12 @@ _load_config()
 			}
 			else {
 				g_warning("Invalid value '%s' for dim_screen in [idle] section of %s",
-					  s, PHONEFSOD_CONFIG);
+					  s, config_file);
 				g_message("Defaulting to DIM_SCREEN_ALWAYS");
 				dim_screen = DIM_SCREEN_ALWAYS;
 			}
+			g_free(s);
+			s = NULL;
 		}
 		minimum_brightness =
 			g_key_file_get_integer(keyfile, "idle",
@@ -337,7 +380,6 @@ _load_config()
 			error = NULL;
 		}
 		else {
-			int i;
 			gchar **flags = g_strsplit(s, ",", 0);
 			idle_screen = IDLE_SCREEN_NEVER;
 			for (i = 0; flags[i]; i++) {
@@ -359,7 +401,8 @@ _load_config()
 				}
 			}
 			g_strfreev(flags);
-			free(s);
+			g_free(s);
+			s = NULL;
 		}
 		s = g_key_file_get_string(keyfile, "idle",
 				"auto_suspend", &error);
@@ -377,6 +420,8 @@ _load_config()
 		else {
 			auto_suspend = SUSPEND_NORMAL;
 		}
+		g_free(s);
+		s = NULL;
 
 		/* --- [settings] --- */
 		quick_settings_power =
@@ -387,62 +432,209 @@ _load_config()
 			g_error_free(error);
 			error = NULL;
 		}
-		if (s)
-			free(s);
 
 		g_debug("Configuration file read");
+		loaded = TRUE;
 	}
 	else {
 		g_warning(error->message);
 		g_error_free(error);
 	}
 
-	debug_level = (debug_level) ? debug_level : DEFAULT_DEBUG_LEVEL;
-	logpath = (logpath) ? logpath : LOGFILE;
-
-	log_flags = G_LOG_FLAG_FATAL;
-	if (!strcmp(debug_level, "DEBUG")) {
-		log_flags |= G_LOG_LEVEL_MASK;
-	}
-	else if (!strcmp(debug_level, "INFO")) {
-		log_flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG);
-	}
-	else if (!strcmp(debug_level, "MESSAGE")) {
-		log_flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
-			| G_LOG_LEVEL_INFO);
-	}
-	else if (!strcmp(debug_level, "WARNING")) {
-		log_flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
-			| G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE);
-	}
-	else if (!strcmp(debug_level, "CRITICAL")) {
-		log_flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
-			| G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE
-			| G_LOG_LEVEL_WARNING);
-	}
-	else if (!strcmp(debug_level, "ERROR")) {
-		log_flags |= G_LOG_LEVEL_MASK ^ (G_LOG_LEVEL_DEBUG
-			| G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE
-			| G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL);
+	/* a config that fails to parse on reload (eg. caught in the
+	 * middle of a save) keeps the levels the daemon runs with */
+	if (!reload || loaded) {
+		log_flags = log_parse_level(debug_level
+				? debug_level : DEFAULT_DEBUG_LEVEL);
+		/* domains without a level of their own use the global one */
+		for (i = 0; i < LOG_DOMAIN_COUNT; i++) {
+			log_levels[i] = (domain_level[i])
+				? log_parse_level(domain_level[i]) : log_flags;
+		}
 	}
-	else {
+	g_free(debug_level);
+	for (i = 0; i < LOG_DOMAIN_COUNT; i++)
+		g_free(domain_level[i]);
+
+	/* the logfile itself is only set up on startup */
+	if (reload) {
+		g_free(logpath);
+		return loaded;
 	}
 
+	if (!logpath)
+		logpath = g_strdup(LOGFILE);
+	recorder_set_log_file(logpath);
+
 	/* initialize logging */
-	logfile = fopen(logpath, "a");
-	if (!logfile) {
+	if (!log_init(logpath, (gsize) log_max_size * 1024, log_max_files)) {
 		printf("Error creating the logfile (%s) !!!", logpath);
 	}
 	else {
 		g_log_set_default_handler(_log_handler, NULL);
 	}
+	g_free(logpath);
+	config_pin = g_strdup(sim_pin);
+	return loaded;
+}
+
+static void
+_snapshot_config(config_snapshot_t *snapshot)
+{
+	snapshot->offline_mode = offline_mode;
+	snapshot->calling_identification = calling_identification;
+	snapshot->pdp_apn = pdp_apn;
+	snapshot->pdp_user = pdp_user;
+	snapshot->pdp_password = pdp_password;
+	snapshot->sim_pin = sim_pin;
+	snapshot->default_brightness = default_brightness;
+	snapshot->minimum_brightness = minimum_brightness;
+	snapshot->dim_idle_percent = dim_idle_percent;
+	snapshot->dim_idle_dim_percent = dim_idle_dim_percent;
+	snapshot->dim_idle_prelock_percent = dim_idle_prelock_percent;
+	snapshot->dim_screen = dim_screen;
+	snapshot->auto_suspend = auto_suspend;
+	snapshot->gsm_reregister_timeout = gsm_reregister_timeout;
 }
 
+/* re-reads the config and applies only the settings that changed...
+ * the rest of the running daemon is left alone */
 static void
 _reload_config()
 {
-	g_debug("reloading configuration");
-	_load_config();
+	config_snapshot_t old;
+	int changes = 0;
+
+	/* changes made over dbus must be in the file before reading it */
+	config_flush();
+
+	/* the strings of the snapshot are the old values themselves...
+	 * _load_config() replaces the globals with new ones */
+	_snapshot_config(&old);
+	if (!_load_config(TRUE))
+		return;
+	config_load(config_file);
+
+	/* SetPin does not save the pin... keep the one given that way
+	 * as long as the pin in the config did not change */
+	if (!g_strcmp0(config_pin, sim_pin)) {
+		if (sim_pin)
+			free(sim_pin);
+		sim_pin = old.sim_pin;
+	}
+	else {
+		g_free(config_pin);
+		config_pin = g_strdup(sim_pin);
+		if (old.sim_pin)
+			free(old.sim_pin);
+		changes++;
+	}
+
+	if (old.offline_mode != offline_mode) {
+		g_message("offline_mode changed to %s",
+			  offline_mode ? "true" : "false");
+		fso_set_functionality();
+		changes++;
+	}
+	if (g_strcmp0(old.pdp_apn, pdp_apn) ||
+	    g_strcmp0(old.pdp_user, pdp_user) ||
+	    g_strcmp0(old.pdp_password, pdp_password)) {
+		fso_pdp_set_credentials();
+		changes++;
+	}
+	if (old.pdp_apn)
+		free(old.pdp_apn);
+	if (old.pdp_user)
+		free(old.pdp_user);
+	if (old.pdp_password)
+		free(old.pdp_password);
+
+	if (old.calling_identification != calling_identification) {
+		fso_set_calling_identification();
+		changes++;
+	}
+	if (old.default_brightness != default_brightness ||
+	    old.minimum_brightness != minimum_brightness ||
+	    old.dim_idle_percent != dim_idle_percent ||
+	    old.dim_idle_dim_percent != dim_idle_dim_percent ||
+	    old.dim_idle_prelock_percent != dim_idle_prelock_percent ||
+	    old.dim_screen != dim_screen) {
+		fso_redim();
+		changes++;
+	}
+	if (old.auto_suspend != auto_suspend) {
+		fso_suspend_update();
+		changes++;
+	}
+	if (old.gsm_reregister_timeout != gsm_reregister_timeout) {
+		fso_reregister_timeout_update();
+		changes++;
+	}
+
+	/* everything else (log levels, idle_screen, quick settings...)
+	 * is looked at whenever it is needed and needs no action */
+	g_message("configuration reloaded (%d setting(s) to apply)", changes);
+	phonefsod_settings_changed();
+}
+
+static gboolean
+_reload_config_timeout(gpointer data)
+{
+	(void) data;
+	config_reload_id = 0;
+	_reload_config();
+	return FALSE;
+}
+
+static gboolean
+_reload_config_idle(gpointer data)
+{
+	(void) data;
+	_reload_config();
+	return FALSE;
+}
+
+/* editors save in several steps... reload once it settled */
+static void
+_config_file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+		     GFileMonitorEvent event, gpointer data)
+{
+	(void) monitor;
+	(void) file;
+	(void) other_file;
+	(void) data;
+
+	if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+	    event != G_FILE_MONITOR_EVENT_CREATED)
+		return;
+	/* config_flush() writing settings changed over dbus */
+	if (config_is_own_write())
+		return;
+
+	if (config_reload_id)
+		g_source_remove(config_reload_id);
+	config_reload_id = g_timeout_add(CONFIG_RELOAD_DELAY,
+					 _reload_config_timeout, NULL);
+}
+
+static void
+_watch_config()
+{
+	GError *error = NULL;
+	GFile *file;
+
+	file = g_file_new_for_path(config_file);
+	config_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE,
+					     NULL, &error);
+	g_object_unref(file);
+	if (error) {
+		g_warning("not watching %s for changes: %s",
+			  config_file, error->message);
+		g_error_free(error);
+		return;
+	}
+	g_signal_connect(config_monitor, "changed",
+			 G_CALLBACK(_config_file_changed), NULL);
 }
 
 
@@ -471,8 +663,18 @@ static gint _process_signals ( siginfo_t *signal_info)
 
 	/* look to see what signal has been caught */
 	switch ( sig ) {
-	case SIGHUP:    /* often used to reload configuration */
-        case SIGUSR1:   /* Any user function */
+	case SIGUSR1:   /* dump the flight recorder */
+		if (recorder_dump(recorder_dump_file()))
+			g_message("flight recorder dumped to %s",
+				  recorder_dump_file());
+		else
+			g_warning("failed dumping the flight recorder to %s: %s",
+				  recorder_dump_file(), g_strerror(errno));
+		break;
+	case SIGHUP:    /* reopen the logfile and reload the configuration */
+		log_reopen();
+		/* the reload has to run in the main loop */
+		g_idle_add(_reload_config_idle, NULL);
 		switch (signal_info->si_code) {
 		case SI_USER:  pch="kill(2) or raise(3)"; break;
 		case SI_KERNEL:  pch="Sent by the kernel."; break;
@@ -484,7 +686,7 @@ static gint _process_signals ( siginfo_t *signal_info)
 		case SI_TKILL:  pch="tkill(2) or tgkill(2)"; break;
 		default: pch = "<unknown>"; break;
 		}
-		g_debug("%s received from => %s ?[pid=%d, uid=%d]{Ignored}",
+		g_debug("%s received from => %s ?[pid=%d, uid=%d]{Reopened log, reloading config}",
                   g_strsignal(sig), pch, signal_info->si_pid,signal_info->si_uid);
 		break;
 	case SIGCHLD:   /* some child ended */
@@ -581,7 +783,7 @@ static gpointer  _thread_handle_signals(gpointer main_loop)
  *
  *  Parse out the command line options from argc,argv
  *  gdaemon_glib [-u|--userid name] [-f|--forcepid] [-p|--pidfile fname]
- *               [-d|--debug XX]  [-v|--version] [-h|--help]
+ *               [-c|--config fname] [-d|--debug XX]  [-v|--version] [-h|--help]
  *
  *  Returns: TRUE if all params where handled
  *          FALSE is any error occurs or an option required shutdown
@@ -597,6 +799,8 @@ static gint _handle_command_line(int argc, char **argv,
 			&gd_pch_pid_filename, "PID Filename", PACKAGE_PIDFILE},
 		{"debug", 'd', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_INT,
 			&i_debug, "Turn on debug messages", "[0|1]"},
+		{"config", 'c', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_FILENAME,
+			&config_file, "Configuration file", PHONEFSOD_CONFIG},
 		{"forcepid", 'f', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE,
 			&gd_b_force, "Force overwite of pid file",
 			"cleanup after prior errors"},
@@ -632,6 +836,10 @@ static gint _handle_command_line(int argc, char **argv,
 		gd_pch_pid_filename = PACKAGE_PIDFILE;
 	}
 
+	if (config_file == NULL) {
+		config_file = PHONEFSOD_CONFIG;
+	}
+
 	return (EXIT_SUCCESS);
 }
 
@@ -640,6 +848,8 @@ static gint _handle_command_line(int argc, char **argv,
  *
  * The single fork method of becoming a daemon, causes the process
  * to become a session leader and process group leader.
+ * The parent waits on a pipe until the child reports readiness
+ * (see phonefsod_ready_set()), dies or DAEMON_READY_TIMEOUT passed.
  *
  * Params:
  *      gd_pch_pid_filename -- pid filename
@@ -658,20 +868,59 @@ static gint _daemonize (gchar *pidfilename)
 	pid_t sid = 0;
 	gint len = 0;
 	gchar ch_buff[16];
+	gint ready_pipe[2];
+	struct pollfd ready_poll;
+	gint64 deadline;
+	gint timeout;
 
 	g_return_val_if_fail(pidfilename != NULL, EXIT_ERROR);
 
+	if (pipe(ready_pipe) < 0) {
+		g_warning("Shutting down as Pid[%d]: pipe(error=%s)",
+				getpid(), strerror(errno));
+		return (EXIT_ERROR);
+	}
+
 	/* Fork off the parent process */
 	switch (pid = fork()) {
 	case -1: /* error -- all out */
 		g_warning("Shutting down as Pid[%d]: fork(error=%s)",
 				getpid(), strerror(errno));
+		close(ready_pipe[0]);
+		close(ready_pipe[1]);
 		return (EXIT_ERROR);
 		break;
 	case 0: /* new process */
-		sleep(1);
+		close(ready_pipe[0]);
+		phonefsod_ready_init(ready_pipe[1]);
 		break;
 	default: /* Normal exit, pid equals child real pid */
+		/* wait until the daemon is usable... EOF means it died */
+		close(ready_pipe[1]);
+		ready_poll.fd = ready_pipe[0];
+		ready_poll.events = POLLIN;
+		deadline = g_get_monotonic_time() +
+			DAEMON_READY_TIMEOUT * G_USEC_PER_SEC;
+		do {
+			timeout = (deadline - g_get_monotonic_time()) / 1000;
+			len = poll(&ready_poll, 1, MAX(timeout, 0));
+		} while (len < 0 && errno == EINTR);
+		if (len == 0) {
+			close(ready_pipe[0]);
+			g_warning("Daemon[%d] did not become ready within %d s",
+					pid, DAEMON_READY_TIMEOUT);
+			return (EXIT_ERROR);
+		}
+		if (len > 0) {
+			do {
+				len = read(ready_pipe[0], ch_buff, 1);
+			} while (len < 0 && errno == EINTR);
+		}
+		close(ready_pipe[0]);
+		if (len != 1) {
+			g_warning("Daemon[%d] exited before becoming ready", pid);
+			return (EXIT_ERROR);
+		}
 		return (EXIT_FAILURE);
 	}
 
@@ -732,6 +981,8 @@ extern int main (int argc, char *argv[])
 	gint      rc = 0;
 	struct    passwd *userinfo = NULL;
 
+	timeline_mark(MILESTONE_PROCESS_START);
+
 	/* initialize threading and mainloop */
 	g_type_init();
 	main_loop = g_main_loop_new (NULL, FALSE);
@@ -782,6 +1033,10 @@ extern int main (int argc, char *argv[])
 		sigfillset (&signal_set);
 		pthread_sigmask (SIG_BLOCK, &signal_set, NULL);
 
+		/* crashes are not for the signal thread... they dump
+		 * the flight recorder in the crashing thread */
+		recorder_install_crash_handler();
+
 		/* create the signal handling thread */
 		sig_thread = g_thread_create ((GThreadFunc)_thread_handle_signals,
 				main_loop, TRUE, &gerror);
@@ -793,8 +1048,13 @@ extern int main (int argc, char *argv[])
 			exit (EXIT_FAILURE);
 		}
 	}
+	else {
+		recorder_install_crash_handler();
+	}
 
-	_load_config();
+	_load_config(FALSE);
+	/* settings changed via dbus are saved through the config store */
+	config_load(config_file);
 
 	if (!phonefsod_dbus_setup()) {
 		g_option_context_free(context);
@@ -802,16 +1062,17 @@ extern int main (int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	_watch_config();
 
-	//notify = inotify_init();
-	//inotify_add_watch(notify, PHONEFSOD_CONFIG, IN_MODIFY);
-
-	/* Start glib main loop and run list_resources() */
+	/* Start glib main loop - fso_startup() is run as soon as
+	 * all the FSO proxies are connected */
 	g_debug("entering glib main loop");
-	g_timeout_add_seconds(1, fso_startup, NULL);
 	g_main_loop_run(main_loop);
 
 	phonefsod_dbus_shutdown();
+	if (config_monitor)
+		g_object_unref(config_monitor);
+	config_shutdown();
 
 	/* Cleanup and exit */
 	if (!i_debug) {
@@ -824,12 +1085,9 @@ extern int main (int argc, char *argv[])
 	}
 	g_main_loop_unref (main_loop);
 
-//	if (incoming_calls)
-//		free(incoming_calls);
-//	if (outgoing_calls)
-//		free(outgoing_calls);
 	if (sim_pin)
 		free(sim_pin);
+	g_free(config_pin);
 	if (pdp_apn)
 		free(pdp_apn);
 	if (pdp_user)
@@ -850,6 +1108,7 @@ extern int main (int argc, char *argv[])
 
 	/* write shutdown messages */
 	g_message("%s-%s clean shutdown", PACKAGE_NAME, PACKAGE_VERSION);
+	log_shutdown();
 
 	exit (EXIT_SUCCESS);
 }
@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+#
+#  Copyright (C) 2009-2012
+#      Authors (alphabetical) :
+#              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+#              Lukas 'slyon' Märdian <luk@slyon.de>
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU Public License as published by
+#  the Free Software Foundation; version 2 of the license or any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser Public License for more details.
+#
+
+"""Runs phonefsod against the mock FSO stack on a private dbus-daemon.
+
+Each run starts a fresh mockfso.py and phonefsod and reads the bring-up
+milestones from GetStartupTimeline() until the network is registered.
+
+  check  one run, fails when a milestone is missing or the registration
+         takes longer than --max-registered ms
+  bench  --runs runs, reports min/median/max per milestone
+
+Arguments after -- are passed on to mockfso.py (eg. --latency 100).
+"""
+
+import argparse
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+import gi
+gi.require_version('Gio', '2.0')
+from gi.repository import Gio, GLib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# what gets reported... milestone names of the startup timeline
+METRICS = [
+    ('gsm-requested', 'time-to-GSM-request'),
+    ('functionality-set', 'time-to-functionality-set'),
+    ('registered', 'time-to-registered'),
+]
+
+CONFIG = '''[logging]
+log_level=DEBUG
+log_file=%(dir)s/phonefsod.log
+
+[gsm]
+offline_mode=false
+inhibit_suspend_on_startup_time=60
+pin=1234
+
+[idle]
+auto_suspend=never
+'''
+
+
+class Harness:
+
+    def __init__(self, options):
+        self.options = options
+        self.dir = tempfile.mkdtemp(prefix='phonefsod-test.')
+        self.config = os.path.join(self.dir, 'phonefsod.conf')
+        with open(self.config, 'w') as f:
+            f.write(CONFIG % {'dir': self.dir})
+        self.bus = None
+        self.address = None
+
+    def start_bus(self):
+        self.bus = subprocess.Popen(
+            ['dbus-daemon', '--nofork', '--print-address',
+             '--config-file=%s' % os.path.join(HERE, 'test-bus.conf')],
+            stdout=subprocess.PIPE, universal_newlines=True)
+        self.address = self.bus.stdout.readline().strip()
+        if not self.address:
+            sys.exit('harness: dbus-daemon did not start')
+
+    def stop(self, process):
+        if process and process.poll() is None:
+            process.send_signal(signal.SIGTERM)
+            try:
+                process.wait(5)
+            except subprocess.TimeoutExpired:
+                process.kill()
+                process.wait()
+
+    def run_once(self):
+        env = dict(os.environ, DBUS_SYSTEM_BUS_ADDRESS=self.address)
+        mock = subprocess.Popen(
+            [sys.executable, os.path.join(HERE, 'mockfso.py')] +
+            self.options.mock_args,
+            env=env, stdout=subprocess.PIPE, universal_newlines=True)
+        phonefsod = None
+        try:
+            if mock.stdout.readline().strip() != 'ready':
+                sys.exit('harness: mockfso.py did not start')
+            phonefsod = subprocess.Popen(
+                [self.options.phonefsod, '-d', '1', '-c', self.config,
+                 '-p', os.path.join(self.dir, 'phonefsod.pid')], env=env)
+            return self.wait_timeline(phonefsod)
+        finally:
+            self.stop(phonefsod)
+            self.stop(mock)
+
+    def wait_timeline(self, phonefsod):
+        conn = Gio.DBusConnection.new_for_address_sync(
+            self.address,
+            Gio.DBusConnectionFlags.AUTHENTICATION_CLIENT |
+            Gio.DBusConnectionFlags.MESSAGE_BUS_CONNECTION,
+            None, None)
+        deadline = time.monotonic() + self.options.timeout
+        timeline = {}
+        while time.monotonic() < deadline:
+            if phonefsod.poll() is not None:
+                sys.exit('harness: phonefsod exited with %d'
+                         % phonefsod.returncode)
+            try:
+                reply = conn.call_sync(
+                    'org.shr.phonefso', '/org/shr/phonefso/Usage',
+                    'org.shr.phonefso.Diagnostics', 'GetStartupTimeline',
+                    None, GLib.VariantType('(a(sx))'),
+                    Gio.DBusCallFlags.NONE, 1000, None)
+                timeline = dict(reply.unpack()[0])
+            except GLib.Error:
+                # not on the bus yet
+                pass
+            if all(name in timeline for name, _ in METRICS):
+                break
+            time.sleep(0.02)
+        conn.close_sync(None)
+        # us since process start -> ms
+        return {name: timeline[name] / 1000.0
+                for name, _ in METRICS if name in timeline}
+
+    def cleanup(self):
+        self.stop(self.bus)
+        shutil.rmtree(self.dir, ignore_errors=True)
+
+
+def check(harness, options):
+    result = harness.run_once()
+    failed = False
+    for name, label in METRICS:
+        if name not in result:
+            print('FAIL: %s not reached within %ds'
+                  % (label, options.timeout))
+            failed = True
+        else:
+            print('%-26s %8.1f ms' % (label, result[name]))
+    registered = result.get('registered')
+    if registered is not None and registered > options.max_registered:
+        print('FAIL: time-to-registered %.1f ms exceeds %d ms'
+              % (registered, options.max_registered))
+        failed = True
+    return 1 if failed else 0
+
+
+def bench(harness, options):
+    runs = []
+    for i in range(options.runs):
+        runs.append(harness.run_once())
+    print('%-26s %8s %8s %8s %5s' % ('', 'min', 'median', 'max', 'runs'))
+    for name, label in METRICS:
+        values = sorted(r[name] for r in runs if name in r)
+        if not values:
+            print('%-26s %8s' % (label, 'never'))
+            continue
+        print('%-26s %8.1f %8.1f %8.1f %5d'
+              % (label, values[0], values[len(values) // 2], values[-1],
+                 len(values)))
+    return 0
+
+
+def main():
+    argv = sys.argv[1:]
+    mock_args = []
+    if '--' in argv:
+        mock_args = argv[argv.index('--') + 1:]
+        argv = argv[:argv.index('--')]
+
+    parser = argparse.ArgumentParser(
+        description=__doc__.splitlines()[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog='\n'.join(__doc__.splitlines()[2:]))
+    parser.add_argument('mode', choices=['check', 'bench'])
+    parser.add_argument('--phonefsod',
+                        default=os.path.join(HERE, '..', 'src', 'phonefsod'))
+    parser.add_argument('--runs', type=int, default=10)
+    parser.add_argument('--timeout', type=int, default=30,
+                        help='s to wait for the registration')
+    parser.add_argument('--max-registered', type=int, default=5000,
+                        help='ms a check may take to register')
+    options = parser.parse_args(argv)
+    options.mock_args = mock_args
+
+    harness = Harness(options)
+    harness.start_bus()
+    try:
+        if options.mode == 'check':
+            return check(harness, options)
+        return bench(harness, options)
+    finally:
+        harness.cleanup()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,431 @@
+#!/usr/bin/env python3
+#
+#  Copyright (C) 2009-2012
+#      Authors (alphabetical) :
+#              Klaus 'mrmoku' Kurzmann <mok@fluxnetz.de>
+#              Lukas 'slyon' Märdian <luk@slyon.de>
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU Public License as published by
+#  the Free Software Foundation; version 2 of the license or any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser Public License for more details.
+#
+
+"""Scripted stand-ins for ousaged, ogsmd, odeviced, opimd and phoneuid.
+
+Only the interfaces phonefsod uses are implemented. Every method reply is
+delayed by a configurable latency, so bring-up can be measured against a
+slow or a fast stack. The modem is modelled just far enough for phonefsod
+to walk through its startup: the GSM resource is enabled on request, the
+SIM becomes ready (or locked) and the network is registered once the
+functionality was set.
+
+Each service owns its name on a connection of its own, as the real ones
+do. The bus is the one in DBUS_SYSTEM_BUS_ADDRESS (or --address).
+"""
+
+import argparse
+import os
+import sys
+
+import gi
+gi.require_version('Gio', '2.0')
+from gi.repository import Gio, GLib
+
+USAGE = 'org.freesmartphone.ousaged'
+GSM = 'org.freesmartphone.ogsmd'
+DEVICE = 'org.freesmartphone.odeviced'
+PIM = 'org.freesmartphone.opimd'
+PHONEUI = 'org.shr.phoneui'
+
+USAGE_XML = '''
+<node>
+  <interface name='org.freesmartphone.Usage'>
+    <method name='ListResources'><arg type='as' direction='out'/></method>
+    <method name='RequestResource'><arg type='s' direction='in'/></method>
+    <method name='ReleaseResource'><arg type='s' direction='in'/></method>
+    <method name='Suspend'/>
+    <signal name='ResourceAvailable'><arg type='s'/><arg type='b'/></signal>
+    <signal name='ResourceChanged'>
+      <arg type='s'/><arg type='b'/><arg type='a{sv}'/>
+    </signal>
+    <signal name='SystemAction'><arg type='s'/></signal>
+  </interface>
+</node>'''
+
+GSM_XML = '''
+<node>
+  <interface name='org.freesmartphone.GSM.Device'>
+    <method name='GetDeviceStatus'><arg type='s' direction='out'/></method>
+    <method name='SetFunctionality'>
+      <arg type='s' direction='in'/><arg type='b' direction='in'/>
+      <arg type='s' direction='in'/>
+    </method>
+    <signal name='DeviceStatus'><arg type='s'/></signal>
+  </interface>
+  <interface name='org.freesmartphone.GSM.SIM'>
+    <method name='GetSimInfo'><arg type='a{sv}' direction='out'/></method>
+  </interface>
+  <interface name='org.freesmartphone.GSM.Network'>
+    <method name='Register'/>
+    <method name='SetCallingIdentification'>
+      <arg type='s' direction='in'/>
+    </method>
+    <signal name='Status'><arg type='a{sv}'/></signal>
+    <signal name='IncomingUssd'><arg type='s'/><arg type='s'/></signal>
+  </interface>
+  <interface name='org.freesmartphone.GSM.PDP'>
+    <method name='SetCredentials'>
+      <arg type='s' direction='in'/><arg type='s' direction='in'/>
+      <arg type='s' direction='in'/>
+    </method>
+  </interface>
+  <interface name='org.freesmartphone.GSM.Call'>
+    <signal name='CallStatus'>
+      <arg type='i'/><arg type='s'/><arg type='a{sv}'/>
+    </signal>
+  </interface>
+</node>'''
+
+IDLE_NOTIFIER_XML = '''
+<node>
+  <interface name='org.freesmartphone.Device.IdleNotifier'>
+    <method name='GetState'><arg type='s' direction='out'/></method>
+    <signal name='State'><arg type='s'/></signal>
+  </interface>
+</node>'''
+
+INPUT_XML = '''
+<node>
+  <interface name='org.freesmartphone.Device.Input'>
+    <signal name='Event'><arg type='s'/><arg type='s'/><arg type='i'/></signal>
+  </interface>
+</node>'''
+
+DISPLAY_XML = '''
+<node>
+  <interface name='org.freesmartphone.Device.Display'>
+    <method name='SetBrightness'><arg type='i' direction='in'/></method>
+  </interface>
+</node>'''
+
+POWER_SUPPLY_XML = '''
+<node>
+  <interface name='org.freesmartphone.Device.PowerSupply'>
+    <method name='GetPowerStatus'><arg type='s' direction='out'/></method>
+    <signal name='PowerStatus'><arg type='s'/></signal>
+  </interface>
+</node>'''
+
+MESSAGES_XML = '''
+<node>
+  <interface name='org.freesmartphone.PIM.Messages'>
+    <signal name='IncomingMessage'><arg type='o'/></signal>
+  </interface>
+</node>'''
+
+CONTACTS_XML = '''
+<node>
+  <interface name='org.freesmartphone.PIM.Contacts'>
+    <method name='Query'>
+      <arg type='a{sv}' direction='in'/><arg type='s' direction='out'/>
+    </method>
+    <signal name='NewContact'><arg type='o'/></signal>
+  </interface>
+</node>'''
+
+CONTACT_QUERY_XML = '''
+<node>
+  <interface name='org.freesmartphone.PIM.ContactQuery'>
+    <method name='GetMultipleResults'>
+      <arg type='i' direction='in'/><arg type='aa{sv}' direction='out'/>
+    </method>
+    <method name='Dispose'/>
+  </interface>
+</node>'''
+
+PHONEUI_XML = {
+    '/org/shr/phoneui/CallManagement': '''
+<node>
+  <interface name='org.shr.phoneui.CallManagement'>
+    <method name='DisplayIncoming'>
+      <arg type='i' direction='in'/><arg type='i' direction='in'/>
+      <arg type='s' direction='in'/>
+    </method>
+    <method name='HideIncoming'><arg type='i' direction='in'/></method>
+    <method name='DisplayOutgoing'>
+      <arg type='i' direction='in'/><arg type='i' direction='in'/>
+      <arg type='s' direction='in'/>
+    </method>
+    <method name='HideOutgoing'><arg type='i' direction='in'/></method>
+  </interface>
+</node>''',
+    '/org/shr/phoneui/Notification': '''
+<node>
+  <interface name='org.shr.phoneui.Notification'>
+    <method name='DisplayDialog'><arg type='i' direction='in'/></method>
+    <method name='DisplaySimAuth'><arg type='i' direction='in'/></method>
+    <method name='HideSimAuth'><arg type='i' direction='in'/></method>
+    <method name='DisplayUssd'>
+      <arg type='i' direction='in'/><arg type='s' direction='in'/>
+    </method>
+  </interface>
+</node>''',
+    '/org/shr/phoneui/IdleScreen': '''
+<node>
+  <interface name='org.shr.phoneui.IdleScreen'>
+    <method name='Display'/>
+    <method name='Hide'/>
+    <method name='Toggle'/>
+    <method name='ActivateScreensaver'/>
+    <method name='DeactivateScreensaver'/>
+  </interface>
+</node>''',
+    '/org/shr/phoneui/Messages': '''
+<node>
+  <interface name='org.shr.phoneui.Messages'>
+    <method name='DisplayMessage'><arg type='s' direction='in'/></method>
+  </interface>
+</node>''',
+    '/org/shr/phoneui/Settings': '''
+<node>
+  <interface name='org.shr.phoneui.Settings'>
+    <method name='DisplayQuickSettings'/>
+  </interface>
+</node>''',
+}
+
+CONTACTS = [
+    {'Name': 'Alice', 'Surname': 'Example', 'Phone': 'tel:+491701234567'},
+    {'Name': 'Bob', 'Surname': '', 'Phone': 'tel:+441234567890'},
+]
+
+
+class MockError(Exception):
+    """makes a method call fail with the given dbus error"""
+
+    def __init__(self, name, message):
+        Exception.__init__(self, message)
+        self.name = name
+
+
+class Service:
+    """one FSO (or phoneuid) service on a bus connection of its own"""
+
+    def __init__(self, mock, address, name):
+        self.mock = mock
+        self.name = name
+        self.handlers = {}
+        self.conn = Gio.DBusConnection.new_for_address_sync(
+            address,
+            Gio.DBusConnectionFlags.AUTHENTICATION_CLIENT |
+            Gio.DBusConnectionFlags.MESSAGE_BUS_CONNECTION,
+            None, None)
+
+    def export(self, path, xml, handlers):
+        for iface in Gio.DBusNodeInfo.new_for_xml(xml).interfaces:
+            self.conn.register_object(path, iface, self._method_call,
+                                      None, None)
+        self.handlers.update(handlers)
+
+    def own(self):
+        self.conn.call_sync('org.freedesktop.DBus', '/org/freedesktop/DBus',
+                            'org.freedesktop.DBus', 'RequestName',
+                            GLib.Variant('(su)', (self.name, 4)), None,
+                            Gio.DBusCallFlags.NONE, -1, None)
+
+    def emit(self, path, iface, signal, fmt=None, args=None):
+        params = GLib.Variant(fmt, args) if fmt else None
+        self.conn.emit_signal(None, path, iface, signal, params)
+
+    def _method_call(self, conn, sender, path, iface, method, params,
+                     invocation):
+        self.mock.log('%s %s.%s%s' % (self.name, iface, method,
+                                      params.unpack()))
+        handler = self.handlers.get(method)
+        try:
+            reply = handler(*params.unpack()) if handler else None
+            error = None
+        except MockError as e:
+            error = e
+
+        def _reply():
+            if error:
+                invocation.return_dbus_error(error.name, str(error))
+            else:
+                invocation.return_value(reply)
+            return False
+        GLib.timeout_add(self.mock.latency(method), _reply)
+
+
+class MockFso:
+
+    def __init__(self, options):
+        self.options = options
+        self.status = 'closed'
+        self.functionality = None
+        self.queries = 0
+
+        address = options.address or \
+            os.environ.get('DBUS_SYSTEM_BUS_ADDRESS')
+        if not address:
+            sys.exit('mockfso: no bus (set DBUS_SYSTEM_BUS_ADDRESS)')
+
+        self.usage = Service(self, address, USAGE)
+        self.usage.export('/org/freesmartphone/Usage', USAGE_XML, {
+            'ListResources': self.list_resources,
+            'RequestResource': self.request_resource,
+        })
+
+        self.gsm = Service(self, address, GSM)
+        self.gsm.export('/org/freesmartphone/GSM/Device', GSM_XML, {
+            'GetDeviceStatus': self.get_device_status,
+            'SetFunctionality': self.set_functionality,
+            'GetSimInfo': self.get_sim_info,
+        })
+
+        self.device = Service(self, address, DEVICE)
+        self.device.export('/org/freesmartphone/Device/IdleNotifier/0',
+                           IDLE_NOTIFIER_XML,
+                           {'GetState': lambda: GLib.Variant('(s)',
+                                                             ('busy',))})
+        self.device.export('/org/freesmartphone/Device/Input', INPUT_XML, {})
+        self.device.export('/org/freesmartphone/Device/Display/0',
+                           DISPLAY_XML, {})
+        self.device.export('/org/freesmartphone/Device/PowerSupply',
+                           POWER_SUPPLY_XML,
+                           {'GetPowerStatus': lambda: GLib.Variant(
+                               '(s)', (options.power_status,))})
+
+        self.pim = Service(self, address, PIM)
+        self.pim.export('/org/freesmartphone/PIM/Messages', MESSAGES_XML, {})
+        self.pim.export('/org/freesmartphone/PIM/Contacts', CONTACTS_XML,
+                        {'Query': self.query})
+
+        self.phoneui = Service(self, address, PHONEUI)
+        for path, xml in PHONEUI_XML.items():
+            self.phoneui.export(path, xml, {})
+
+    def start(self):
+        # the order they usually come up in on a phone
+        for service in (self.device, self.usage, self.pim, self.gsm,
+                        self.phoneui):
+            service.own()
+        self.log('ready')
+
+    def log(self, message):
+        if self.options.verbose:
+            print('mockfso: %s' % message, file=sys.stderr, flush=True)
+
+    def latency(self, method):
+        return self.options.method_latency.get(method, self.options.latency)
+
+    def later(self, ms, func, *args):
+        def _fire():
+            func(*args)
+            return False
+        GLib.timeout_add(ms, _fire)
+
+    # --- ousaged ---
+    def list_resources(self):
+        return GLib.Variant('(as)', (['CPU', 'Display', 'GSM'],))
+
+    def request_resource(self, name):
+        self.usage.emit('/org/freesmartphone/Usage',
+                        'org.freesmartphone.Usage', 'ResourceChanged',
+                        '(sba{sv})', (name, True, {
+                            'policy': GLib.Variant('s', 'auto'),
+                            'refcount': GLib.Variant('i', 1)}))
+        if name == 'GSM' and self.status == 'closed':
+            self.later(self.options.modem_delay, self.modem_alive)
+
+    # --- ogsmd ---
+    def set_status(self, status):
+        self.status = status
+        self.gsm.emit('/org/freesmartphone/GSM/Device',
+                      'org.freesmartphone.GSM.Device', 'DeviceStatus',
+                      '(s)', (status,))
+
+    def modem_alive(self):
+        self.set_status('alive-sim-locked' if self.options.sim_locked
+                        else 'alive-sim-ready')
+
+    def get_device_status(self):
+        return GLib.Variant('(s)', (self.status,))
+
+    def set_functionality(self, level, autoregister, pin):
+        self.functionality = level
+        if self.status == 'alive-sim-locked':
+            if pin != self.options.pin:
+                raise MockError('org.freesmartphone.GSM.SIM.AuthFailed',
+                                'wrong PIN')
+            self.later(self.options.modem_delay, self.set_status,
+                       'alive-sim-ready')
+        if level == 'full' and autoregister:
+            self.later(self.options.register_delay, self.set_status,
+                       'alive-registered')
+        elif level == 'airplane':
+            self.later(0, self.set_status, 'alive-sim-ready')
+        return None
+
+    def get_sim_info(self):
+        return GLib.Variant('(a{sv})', ({
+            'slots': GLib.Variant('i', 30),
+            'used': GLib.Variant('i', 3)},))
+
+    # --- opimd ---
+    def query(self, query):
+        self.queries += 1
+        path = '/org/freesmartphone/PIM/Contacts/Queries/%d' % self.queries
+        self.pim.export(path, CONTACT_QUERY_XML, {
+            'GetMultipleResults': lambda count: GLib.Variant(
+                '(aa{sv})', ([{k: GLib.Variant('s', v)
+                               for k, v in c.items()} for c in CONTACTS],)),
+        })
+        return GLib.Variant('(s)', (path,))
+
+
+def _method_latency(values):
+    latencies = {}
+    for value in values:
+        method, _, ms = value.partition('=')
+        latencies[method] = int(ms)
+    return latencies
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--address', help='bus to use instead of '
+                        'DBUS_SYSTEM_BUS_ADDRESS')
+    parser.add_argument('--latency', type=int, default=20,
+                        help='ms every method call takes (default 20)')
+    parser.add_argument('--method-latency', action='append', default=[],
+                        metavar='METHOD=MS',
+                        help='latency of a single method, eg. '
+                        'RequestResource=500')
+    parser.add_argument('--modem-delay', type=int, default=200,
+                        help='ms from GSM requested to the SIM being ready')
+    parser.add_argument('--register-delay', type=int, default=500,
+                        help='ms from functionality set to registered')
+    parser.add_argument('--sim-locked', action='store_true',
+                        help='the SIM needs a PIN')
+    parser.add_argument('--pin', default='1234',
+                        help='PIN of a locked SIM (default 1234)')
+    parser.add_argument('--power-status', default='discharging')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    options = parser.parse_args()
+    options.method_latency = _method_latency(options.method_latency)
+
+    mock = MockFso(options)
+    mock.start()
+    # tell a harness waiting on stdout that all names are owned
+    print('ready', flush=True)
+    GLib.MainLoop().run()
+
+
+if __name__ == '__main__':
+    main()